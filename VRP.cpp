@@ -11,6 +11,27 @@
 #include <ctime>
 #include <chrono>
 #include <random>
+#include <new>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <filesystem>
+#include <glob.h>
+#include <charconv>
+#include <string_view>
+#include <unordered_map>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstdint>
+#include <cstring>
+#include <climits>
+#include <ext/pb_ds/assoc_container.hpp>
+#include <ext/pb_ds/tree_policy.hpp>
+#ifdef __x86_64__
+#include <immintrin.h>
+#endif
 
 using namespace std;
 
@@ -37,20 +58,20 @@ struct Coordinate {
 struct Request {
     string customer_id;
     string location_id;
+    int location;       //interned index of location_id in the travel matrix
+    int customer;       //index of customer_id in customerFirst of the instance
     Coordinate coordinate;
     int demand;
     bool inRoute;
     TimeWindow timeWindow;
 };
 
-struct Rate {
-    int time;
-    int cost;
-    float distancne;
-};
-
+/*
+ * route holds the index in requests of each visit, which is also its location index,
+ * so a route and its schedule vectors are plain int arrays that copy with memcpy
+ */
 struct Technician {
-    vector<Request> route;
+    vector<int> route;
     vector<int> waitTime;
     vector<int> shift;
     vector<int> maxShift;
@@ -67,392 +88,2361 @@ struct BestPair {
     int indexOfRequest;
 };
 
-struct RequestAndScore {
-    string _id;
-    int score;
-};
-
-//Matrix save on cost, distance, time
-map < string, map<string, Rate> > travelTimeMatrix;
-
-//Simple function
-int maxOf(int, int);
-int minOf(int, int);
-//End simple function
-
 /*
- * Compare score to sort request
+ * Result of probing one request at one position of a route
  */
-bool compareScoreToSort(RequestAndScore, RequestAndScore);
+struct InsertionCandidate {
+    bool feasible;
+    int shift;
+    int arrivingTime;
+    int waitTime;
+    int cost;           //cost(prev, request) + cost(request, next)
+    int costDelta;      //cost - cost(prev, next)
+};
 
 /*
- * Calcualte distance between two requests
+ * Ratio used to rank insertion candidates, higher is better
  */
-float calculateDistance(Coordinate visit1, Coordinate visit2);
+enum InsertionRule {
+    FIRST_RULE,     //lowest calculateRatio(shift, cost)
+    SCORE_RULE,     //highest calculateRatio(shift, cost)
+    GREEDY_RULE,    //highest calculateRatio(1, costDelta)
+    REGRET_RULE     //lowest costDelta, ratio is -costDelta
+};
 
 /*
- * Insert a request to technician and update it's parameters
+ * Best insertion of every request into every route. entries[request * numberRoutes + route]
+ * is only recomputed for the route changed by the last insertion, bestOfRequest[request]
+ * is the best entry of the request over all routes. The Solver keeps one, initInsertionCache
+ * resets it at every construction so its arrays are only allocated once
  */
-void insertToRoute(Request &, int pos, Technician &, int shift, vector < Request > &);
+struct InsertionCache {
+    InsertionRule rule;
+    bool granular;
+    float noRatio;
+    int numberRoutes;
+    vector < BestPair > entries;
+    vector < BestPair > bestOfRequest;
+    vector < char > emptyRoute;     //routes holding only the depots
+    int k;                          //regret insertion: routes ranked per request
+    vector < int > topRoutes;       //regret insertion: k best routes of each request, -1 when fewer
+};
 
 /*
- * Calculate shift, arrivingTime, waittingTime, maxShift in insertionStep
+ * Search configuration, from the command line and key=value config files (see setConfig).
+ * A limit of 0 is no limit, the improvement phase stops at the first limit reached
  */
-int calculateShift(Request &, Technician &, int) ;
-int calculateArrivingTime(Request, Technician, int);
-int calculateWaitTime(Request, Technician, int);
-int calculateMaxShift(Request, Technician, int);
-int calculateStartTime(Request, Technician, int);
-float calculateRatio(int, float);
+struct Config {
+    int number_iteration;       //iterations key, ILS iterations (per trajectory in parallel)
+    double time_limit;          //time_limit key, seconds of wall clock for the improvement phase
+    int no_improvement_limit;   //no_improvement key, iterations in a row without a better solution
+    int erase_min;              //erase_min key, shaking removes erase_min .. erase_max_ratio * customers
+    float erase_max_ratio;      //erase_max_ratio key
+    float worst_p;              //worst_p key, randomness of worst removal
+    float shaw_p;               //shaw_p key, randomness of shaw removal, 0 is the number removed
+    float removal_weight[3];    //removal_random, removal_worst, removal_shaw keys
+    float insertion_weight[4];  //insertion_score, insertion_greedy, insertion_regret2, insertion_regret3 keys
+    bool granular;              //granular key, insert only next to neighbors of the request
+    bool adaptive;              //adaptive key, re-weight operators by improvement per millisecond
+    int adaptive_segment;       //adaptive_segment key, iterations between two re-weightings
+    float adaptive_reaction;    //adaptive_reaction key, 0 keeps the weights, 1 forgets the past
+    bool local_search;          //local_search key, improve every repaired solution with localSearch
+    int exchange_interval;      //exchange_interval key, parallel ILS: iterations between two exchanges
+    float restart_gap;          //restart_gap key, parallel ILS: restart a trajectory lagging by this share, 0 never
+};
 
 /*
- * Update parameter while insert a request to route
+ * Adaptive weights of one operator family (removal or insertion). Every iteration credits
+ * the cost improvement of the repair (before local search) and the time of the operator used;
+ * at the end of a segment weights move toward the improvement per millisecond of the segment.
+ * Counters cover the whole run
  */
-void updateAfter(Technician &, int);
-void updateBefore(Technician &, int);
+struct OperatorStats {
+    vector < string > name;
+    vector < float > weight;        //selection weights, 0 when disabled by the configuration
+    vector < int > calls;
+    vector < int > improvements;    //iterations accepted with a better cost
+    vector < double > gain;         //cost improvement
+    vector < double > time;         //milliseconds
+    vector < double > segmentGain;
+    vector < double > segmentTime;
+};
 
 /*
- * Calculate objective: cost of all vehicle in problem
+ * Options of parallel ILS: number_thread independent trajectories of Config::number_iteration
+ * iterations, exchanging with the shared best solution every exchange_interval iterations
  */
-int objective(vector < Technician >);
+struct ParallelOptions {
+    int number_thread;
+    int exchange_interval;
+    bool restart_lagging;   //restart a trajectory from the shared best when it lags
+    float restart_gap;      //lagging: cost > (1 + restart_gap) * best cost
+};
 
 /*
- * Check time window for a route
- * @return true if route has saptified
+ * Best solution shared by all trajectories of parallel ILS
  */
-bool checkTimeWindow(Technician);
+struct SharedBest {
+    mutex lock;
+    vector < Technician > solution;
+    vector < Request > requests;
+    int cost;
+    int iterations;     //done by all trajectories
+    OperatorStats removal;      //summed over trajectories, weights averaged
+    OperatorStats insertion;
+    int number_merged;
+};
 
 /*
- * Read data from input file(.txt)
+ * Result record of one instance solved in batch mode
  */
-void readData(string, Parameters &, vector < Request > &);
+struct InstanceResult {
+    string path;
+    bool loaded;
+    string error;                           //why the instance was not solved, empty when it was
+    int cost;
+    int unassigned;                         //customers left out of the routes
+    int iterations;
+    double wall_time;                       //seconds
+    vector < vector < string > > routes;    //location_id of non empty routes
+    OperatorStats removal;                  //final weights and counters of the operators
+    OperatorStats insertion;
+};
 
 /*
- * Initial Technician: insert depot to zero
+ * Shape of a synthetic instance built by generateInstance
  */
-void initTechnician(vector < Technician > &, vector < Request > &, Parameters);
+struct GeneratorOptions {
+    int number_customers;
+    int windows_per_customer;   //each customer gets 1 .. windows_per_customer time windows
+    int time_horizon;
+    float tightness;            //share of its feasible span covered by the windows of a customer, 0 to 1
+    int demand_min;
+    int demand_max;
+    int vehicle_capacity;
+};
 
 /*
- * Check all request in route
- * @return true if all request in Route
+ * Cursor over the memory mapped text of an instance file
  */
-bool checkAllRequest(vector < Request > requests);
+struct TextScanner {
+    const char * pos;
+    const char * end;
+};
 
 /*
- * Display route for problem
+ * Binary instance cache <instance>.bin: header, request table, coordinates, strings,
+ * then 64-byte aligned time, cost and distance matrices and the nearest and compatible
+ * neighbor lists (neighbor_k per location). source_size/source_mtime identify the text
+ * file it was built from, checksum is FNV-1a by 8-byte words of everything after the header
  */
-void displayRoute(vector < Technician >);
+const char BINARY_MAGIC[8] = {'T', 'O', 'P', 'T', 'W', 'B', 'I', 'N'};
+const uint32_t BINARY_VERSION = 2;
+
+struct BinaryHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t number_requests;
+    uint64_t source_size;
+    int64_t source_mtime;
+    uint64_t payload_size;
+    uint64_t checksum;
+    int32_t number_customers;
+    int32_t number_locations;
+    int32_t time_horizon;
+    int32_t vehicle_capacity;
+    uint32_t string_bytes;
+    uint32_t neighbor_k;
+    uint32_t reserved[14];
+};
+
+static_assert(sizeof(BinaryHeader) == 128, "binary cache header must stay 128 bytes");
+
+struct BinaryRequest {
+    uint32_t customer_offset;
+    uint32_t customer_length;
+    uint32_t location_offset;
+    uint32_t location_length;
+    int32_t demand;
+    int32_t open;
+    int32_t close;
+};
 
 /*
- *  Algorithm insert request to Route
+ * Offsets of the sections of a binary cache payload, from the start of the payload
  */
-void firstInsertion(vector < Technician > &, vector < Request > &, Parameters);
-void scoreInsertion(vector < Technician > &, vector < Request > &, Parameters);
-void greedyBasicInsertion(vector < Technician > &, vector < Request > &, Parameters);
-void regretInsertion(vector < Technician > & solution, vector < Request > & requests, Parameters parameters){
+struct BinaryLayout {
+    uint64_t requests;
+    uint64_t coordinates;
+    uint64_t strings;
+    uint64_t time;
+    uint64_t cost;
+    uint64_t distance;
+    uint64_t nearest;
+    uint64_t compatible;
+    uint64_t size;
+};
 
-}
+struct RequestAndScore {
+    int _id;
+    int score;
+};
 
 /*
- * Insertion Step in ILS
+ * Order statistic set of worst removal: (removal gain, location), highest gain first and
+ * ties by location, so the x-th worst location is found, erased or updated in O(log n)
  */
-void insertionStep(vector < Technician > &, vector < Request > &, Parameters);
+typedef __gnu_pbds::tree < pair < int, int >, __gnu_pbds::null_type, greater < pair < int, int > >,
+                           __gnu_pbds::rb_tree_tag, __gnu_pbds::tree_order_statistics_node_update > RemovalGainSet;
 
 /*
- * Update parameter after remove list request
+ * Start time of every location in the solution being shaken, so the
+ * relatedness of two locations needs no scan of the routes
  */
-void updateAfterErase(Technician &, Parameters);
+struct Relatedness {
+    vector < int > startTime;
+};
 
 /*
- * Remove location_is from vehicle with a customer
+ * Allocator returning cache-line aligned storage for the travel matrix arrays
  */
-void fixRequestInRoute(string, vector < Request > &);
+template <typename T>
+struct AlignedAllocator {
+    typedef T value_type;
+    static const size_t alignment = 64;
+
+    AlignedAllocator() {}
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U> &) {}
+
+    T * allocate(size_t n) {
+        return static_cast<T *>(::operator new(n * sizeof(T), align_val_t(alignment)));
+    }
+    void deallocate(T * p, size_t) {
+        ::operator delete(p, align_val_t(alignment));
+    }
+};
+
+template <typename T, typename U>
+bool operator==(const AlignedAllocator<T> &, const AlignedAllocator<U> &) { return true; }
+template <typename T, typename U>
+bool operator!=(const AlignedAllocator<T> &, const AlignedAllocator<U> &) { return false; }
 
 /*
- * Algorithm removal
+ * Travel matrix: location ids are interned to 0..size-1 and every arc (src, dst)
+ * is stored row-major at src * size + dst, one array per field.
+ * timeToward/costToward are the transposes (dst * size + src), so the arcs from every
+ * location into one destination are contiguous for the insertion kernel
  */
-void randomRemoval(vector < Technician > &, int, vector < Request > &, Parameters);
-void worstRemoval(vector < Technician > &, int, float, vector < Request > &, Parameters);
-void shawRemoval(vector < Technician > &, int, float, vector < Request > &, Parameters);
-void time_orientedRemoval(vector < Technician > &, int, float, vector < Request > &, Parameters);
+struct TravelMatrix {
+    int size;
+    vector < int, AlignedAllocator<int> > time;
+    vector < int, AlignedAllocator<int> > cost;
+    vector < float, AlignedAllocator<float> > distance;
+    vector < int, AlignedAllocator<int> > timeToward;
+    vector < int, AlignedAllocator<int> > costToward;
+};
 
 /*
- * Calculate shaw score for shaw removal
+ * Request fields read by the insertion kernel, one array per field indexed by location
  */
-int calculateShawScore(Request, Request, vector < Technician > &);
+struct RequestArrays {
+    vector < int, AlignedAllocator<int> > open;
+    vector < int, AlignedAllocator<int> > close;
+    vector < int, AlignedAllocator<int> > demand;
+};
 
 /*
- * No comment
+ * Per request output of the insertion kernel for one route: best ratio, position and shift.
+ * active[i] is -1 when request i may go to the route (not in route, fits capacity), else 0
  */
-void sortListLocation(int r, vector < int >, vector < Technician> &, vector < Request >);
+struct KernelScratch {
+    vector < int, AlignedAllocator<int> > active;
+    vector < float, AlignedAllocator<float> > ratio;
+    vector < int, AlignedAllocator<int> > position;
+    vector < int, AlignedAllocator<int> > shift;
+};
 
 /*
- * Shaking step in ILS
+ * Granular neighborhood: for every location its k nearest locations by travel time
+ * and its k most compatible ones by time window, k per location row-major.
+ * allowed[r * size + l] is true when l is in a list of r or r in a list of l
  */
-void shakingStep(vector < Technician > &, vector < Request > &, Parameters);
+const int NEIGHBOR_COUNT = 16;
+
+struct NeighborLists {
+    int k;
+    vector < int > nearest;
+    vector < int > compatible;
+    vector < char > allowed;
+};
 
 /*
- * Heristic of ILS
+ * Data of one instance loaded by readData: never modified by the search,
+ * so one instance can be shared read only by any number of solvers
  */
-void heuristic(vector < Technician > &, vector < Request > &, Parameters);
+struct ProblemInstance {
+    Parameters parameters;
+    vector < Request > requests;    //all inRoute = false
+    TravelMatrix matrix;            //Matrix save on cost, distance, time
+    vector < int > customerFirst;   //locations of customer c are customerFirst[c] .. customerFirst[c + 1] - 1
+    NeighborLists neighbors;        //candidate lists of granular insertion
+    RequestArrays requestArrays;    //open, close, demand of requests for the insertion kernel
+};
 
 /*
- * Creat inittial solution
+ * Undo log of one ILS iteration: a route is saved before its first change and every
+ * inRoute flip is recorded, so rejecting the iteration only restores what it touched
  */
-void initSolution(vector < Technician > &, vector < Request > &, Parameters);
+struct MoveJournal {
+    bool active;
+    int numberSaved;
+    vector < int > savedRouteIds;
+    vector < Technician > savedRoutes;      //reused between iterations, never shrunk
+    vector < char > isSaved;                //per route of the solution
+    vector < int > flippedRequests;
+    vector < char > flippedValues;          //inRoute before the flip
+};
 
+/*
+ * Convergence trace file shared by the solvers of a run: one CSV line per ILS iteration
+ * with run, iteration, seconds since the trace was opened, cost of the iteration's solution,
+ * best cost of the run, removal and insertion operators and number of customers removed.
+ * Solvers fill their own buffer and append it under lock, see traceIteration
+ */
+struct TraceWriter {
+    mutex lock;
+    ofstream file;
+    chrono::steady_clock::time_point start;
+};
 
+const size_t TRACE_BUFFER_SIZE = 1 << 16;
 
-int main() {
-    srand(time(NULL));
+/*
+ * Buffers of the local search moves, reused by every move so that scanning a location allocates
+ * nothing. loadBefore[location] is the demand of its route up to and including the location,
+ * set for every route when localSearch starts and kept by setRoute
+ */
+struct LocalSearchScratch {
+    vector < pair < int, int > > targets;   //relocate: route and position of each insertion tried
+    vector < int > visits;                  //new route built by a move
+    vector < int > otherVisits;             //second new route of swap and 2-opt*
+    vector < int > forward;                 //2-opt: cost along the route up to each position
+    vector < int > backward;                //2-opt: cost of the reversed arcs up to each position
+    vector < int > loadBefore;
+};
 
-    int number_intance = 5;
+/*
+ * Mutable state of one search on an instance: inRoute flags, random engine and undo log.
+ * Solvers share nothing but their instance and trace, so several can run concurrently
+ */
+struct Solver {
+    const ProblemInstance * instance;
+    vector < Request > requests;
+    mt19937 rng;
+    MoveJournal journal;
+    vector < int > unassigned;      //customers not in route, in any order
+    vector < int > unassignedPos;   //position of each customer in unassigned, -1 when in route
+    Config config;
+    OperatorStats removal;
+    OperatorStats insertion;
+    int segmentIterations;                      //iterations since the last re-weighting
+    chrono::steady_clock::time_point deadline;  //end of the improvement phase when config.time_limit > 0
+    int noImprovement;                          //iterations since the last better solution
+    vector < int > routeOf;         //route of each location in the solution, -1 when not in route
+    vector < int > positionOf;      //position of each location in its route, depots are never indexed
+    KernelScratch scratch;          //reused by every evaluateRouteInsertions
+    LocalSearchScratch moveScratch; //reused by every local search move
+    InsertionCache insertionCache;  //reused by every bestInsertion and regretInsertion
+    TraceWriter * trace;            //convergence trace, NULL when off
+    int traceRun;                   //run column of the trace: trajectory or instance number
+    int traceIteration;             //iterations traced by this solver
+    string traceBuffer;             //lines not yet written to trace
+};
 
-    const clock_t begin_time = clock();
-    cout << "VRPRD start..." << endl;
+/*
+ * Hot path instrumentation, compiled in with -DVRP_PROFILE (cmake -DVRP_PROFILE=ON):
+ * calls and inclusive time of the timers, plus counters. Every thread adds to its own
+ * profileData, merged into profileTotal when the thread ends, so the hot path takes no lock.
+ * Without VRP_PROFILE the PROFILE_ macros expand to nothing
+ */
+enum ProfileTimer {
+    PROFILE_READ_DATA,
+    PROFILE_RANDOM_REMOVAL,
+    PROFILE_WORST_REMOVAL,
+    PROFILE_SHAW_REMOVAL,
+    PROFILE_FIRST_INSERTION,
+    PROFILE_SCORE_INSERTION,
+    PROFILE_GREEDY_INSERTION,
+    PROFILE_REGRET2_INSERTION,
+    PROFILE_REGRET3_INSERTION,
+    PROFILE_LOCAL_SEARCH,
+    PROFILE_UPDATE_AFTER,
+    PROFILE_UPDATE_BEFORE,
+    PROFILE_UPDATE_AFTER_ERASE,
+    PROFILE_OBJECTIVE,
+    PROFILE_TIMER_COUNT
+};
 
-    string path;
-    Parameters parameters;
+enum ProfileCounter {
+    PROFILE_ITERATIONS,
+    PROFILE_ACCEPTED,               //iterations kept: better solution
+    PROFILE_REJECTED,               //iterations rolled back
+    PROFILE_INSERTION_PROBES,       //(request, position) pairs given to the insertion kernel
+    PROFILE_LOCAL_SEARCH_PROBES,    //delayFits checks of local search moves
+    PROFILE_LOCAL_SEARCH_MOVES,     //improving moves applied by local search
+    PROFILE_COUNTER_COUNT
+};
 
-    for(int i = 0; i < number_intance; i++){
+#ifdef VRP_PROFILE
+struct ProfileData {
+    int64_t calls[PROFILE_TIMER_COUNT];
+    int64_t nanoseconds[PROFILE_TIMER_COUNT];
+    int64_t counters[PROFILE_COUNTER_COUNT];
+    ProfileData();
+    ~ProfileData();
+};
 
-        cout << "+)Intance " << i << " start..." << endl;
+struct ProfileScope {
+    ProfileTimer timer;
+    chrono::steady_clock::time_point start;
+    ProfileScope(ProfileTimer);
+    ~ProfileScope();
+};
 
-        const clock_t begin_time_intance = clock();
-        path = "instance/instance_" + to_string(i) + "-triangle.txt";
-        vector < Request > requests(0);
-        vector < Technician > solution(0);
-        readData(path, parameters, requests);
-        initSolution(solution, requests, parameters);
-        cout << "\tCreate initial solution success." << endl;
-        cout << "\tImprove solution..." << endl;
-        heuristic(solution, requests, parameters);
-        displayRoute(solution);
+thread_local ProfileData profileData;
 
-        cout << "\t=> Intance " << i << " success in " << float(clock() - begin_time_intance) << endl;
-        break;
-    }
+#define PROFILE_SCOPE(timer) ProfileScope profileScope(timer)
+#define PROFILE_COUNT(counter, number) (profileData.counters[counter] += (number))
+#else
+#define PROFILE_SCOPE(timer)
+#define PROFILE_COUNT(counter, number)
+#endif
 
-    cout << "Spend total time: " << float( clock() - begin_time) / CLOCKS_PER_SEC << endl;
-    cout << "VRPRD success!!!" << endl;
-    return 0;
+inline int randomInt(mt19937 & rng, int n){
+    return uniform_int_distribution<int>(0, n - 1)(rng);
 }
 
-/*
- * Area Define function
- */
-
-int maxOf(int num1, int num2){
-    if(num1 > num2){
-        return num1;
-    }else{
-        return num2;
-    }
+//Uniform in [0, 1)
+inline double randomUnit(mt19937 & rng){
+    return uniform_real_distribution<double>(0.0, 1.0)(rng);
 }
 
-int minOf(int num1, int num2){
-    if(num1 < num2){
-        return num1;
-    }else{
-        return num2;
-    }
+inline int travelTime(const TravelMatrix & matrix, int src, int dst){
+    return matrix.time[src * matrix.size + dst];
 }
 
-float calculateDistance(Coordinate visit1, Coordinate visit2) {
-    return float(sqrt(pow(visit1.x - visit2.x, 2.0) + pow(visit1.y - visit2.y, 2.0)));
+inline int travelCost(const TravelMatrix & matrix, int src, int dst){
+    return matrix.cost[src * matrix.size + dst];
 }
 
-int calculateShift(Request & _request, Technician & _tech, int pos) {
-    return travelTimeMatrix[_tech.route[pos-1].location_id][_request.location_id].time
-           + calculateWaitTime(_request, _tech, pos)
-           + travelTimeMatrix[_request.location_id][_tech.route[pos].location_id].time
-           - travelTimeMatrix[_tech.route[pos-1].location_id][_tech.route[pos].location_id].time;
+inline float travelDistance(const TravelMatrix & matrix, int src, int dst){
+    return matrix.distance[src * matrix.size + dst];
 }
 
-int calculateArrivingTime(Request _request, Technician _tech, int pos){
-    return _tech.startTime[pos-1] + travelTimeMatrix[_tech.route[pos-1].location_id][_request.location_id].time;
-}
+//Simple function
+int maxOf(int, int);
+int minOf(int, int);
+//End simple function
 
-int calculateWaitTime(Request _request, Technician _tech, int pos){
-    return maxOf(0, _request.timeWindow.open - calculateArrivingTime(_request, _tech, pos));
-}
+/*
+ * Cost saved by taking location out from between prev and next
+ */
+int removalGain(const TravelMatrix &, int prev, int location, int next);
 
-int calculateMaxShift(Request _request, Technician _tech, int pos){
-    return minOf(_request.timeWindow.close - _tech.startTime[pos], _tech.waitTime[pos+1] + _tech.maxShift[pos+1]);
-}
+/*
+ * Calcualte distance between two requests
+ */
+float calculateDistance(Coordinate visit1, Coordinate visit2);
 
-int calculateStartTime(Request _request, Technician _tech, int pos){
-    return maxOf(_request.timeWindow.open, _tech.startTime[pos-1] + travelTimeMatrix[_tech.route[pos-1].location_id][_request.location_id].time);
-}
+/*
+ * Insert a request to technician and update it's parameters
+ */
+void insertToRoute(Solver &, Request &, int pos, vector < Technician > &, int route, int shift);
 
-float calculateRatio(int shift, float cost){
-    //Formulate for ratio ?
-    //return 100.0 / (shift * shift + cost);
-    //return 100.0 / shift;
-    return 100.0 / (shift * cost); //best
-    //return 100.0 / (shift + cost);
-    //return 100.0 / ((shift + cost)*cost);
-    //return 100.0 / (shift * shift * cost);
-    //return 100.0 / (shift * pow(cost, 4.0));
-}
+/*
+ * Calculate shift, arrivingTime, waittingTime, maxShift in insertionStep
+ */
+int calculateShift(const TravelMatrix &, const Request &, const Technician &, int) ;
+int calculateArrivingTime(const TravelMatrix &, const Request &, const Technician &, int);
+int calculateWaitTime(const TravelMatrix &, const Request &, const Technician &, int);
+int calculateMaxShift(const Request &, const Technician &, int);
+int calculateStartTime(const TravelMatrix &, const Request &, const Technician &, int);
+float calculateRatio(int, float);
 
-void insertToRoute(Request & _request, int pos, Technician & _tech, int shift, vector < Request > & requests){
-    _request.inRoute = true;
+/*
+ * Check capacity and time window of inserting a request before position pos,
+ * and its shift and cost delta, using waitTime/maxShift of the route: O(1), no copy
+ */
+InsertionCandidate evaluateInsertion(const ProblemInstance &, const Request &, const Technician &, int pos);
+float insertionRatio(InsertionRule, const InsertionCandidate &);
 
-    //Update all position of customer in route
-    for(int i = 0; i < requests.size(); i++){
-        if(requests[i].customer_id == _request.customer_id){
-            requests[i].inRoute = true;
-        }
-    }
+/*
+ * Update parameter while insert a request to route
+ */
+void updateAfter(Technician &, int);
+void updateBefore(const ProblemInstance &, Technician &, int);
 
+/*
+ * Calculate objective: cost of all vehicle in problem
+ */
+int objective(const ProblemInstance &, const vector < Technician > &);
 
-    _tech.route.insert(_tech.route.begin() + pos, _request);
-    _tech.shift.insert(_tech.shift.begin() + pos, shift);
-    _tech.waitTime.insert(_tech.waitTime.begin() + pos, calculateWaitTime(_request, _tech, pos));
-    _tech.arrivingTime.insert(_tech.arrivingTime.begin() + pos, calculateArrivingTime(_request, _tech, pos));
-    _tech.startTime.insert(_tech.startTime.begin() + pos, maxOf(_request.timeWindow.open, _tech.arrivingTime[pos]));
-    _tech.maxShift.insert(_tech.maxShift.begin() + pos, 0);
+/*
+ * Check time window for a route
+ * @return true if route has saptified
+ */
+bool checkTimeWindow(const ProblemInstance &, const Technician &);
 
-    _tech.usedSize += _request.demand;
-}
+/*
+ * Read data from input file(.txt), through its binary cache <path>.bin when it is
+ * up to date, otherwise from the text which then refreshes the cache
+ */
+bool readData(string, ProblemInstance &);
+bool readTextData(string, ProblemInstance &);
 
-void readData(string path, Parameters & parameters, vector < Request > & requests) {
-    //open file to read
-    ifstream file;
-    file.open(path, ios::in);
+/*
+ * Synthetic instance in memory, the same for the same options and seed: customers uniform
+ * in a disc around the depot, travel time 2 * distance and cost distance as in the shipped
+ * instances, both rounded up so that they keep the triangle inequality, every customer
+ * reachable and back before the horizon in each of its windows
+ */
+GeneratorOptions defaultGeneratorOptions();
+void generateInstance(ProblemInstance &, const GeneratorOptions &, unsigned seed);
 
-    char line[256];
+/*
+ * Write instance in the text format read by readData, the matrix row by row
+ * @return false when the file cannot be written
+ */
+bool writeInstance(string, const ProblemInstance &);
+void appendInt(string &, int);
+void appendFloat(string &, float);
 
-    /*
-     * Read genaral paramaters
-     */
-    file.getline(line, 256);
-    //cout << line << endl;
-    file >> parameters.number_customers >> parameters.number_locations >> parameters.time_horizon >> parameters.vehicle_capacity;
-    //cout << parameters.number_customers << " " << parameters.number_locations << " " << parameters.time_horizon << " " << parameters.vehicle_capacity << endl;
-    parameters.number_vehicle = parameters.number_customers;
+/*
+ * Derived data of a loaded instance: customer index, neighbor lists, kernel arrays.
+ * hasNeighborLists: nearest and compatible lists come from the binary cache, only
+ * their allowed mask is rebuilt
+ */
+void prepareInstance(ProblemInstance &, bool hasNeighborLists);
 
-    //read tab, end line, title
-    for (int i = 0; i < 4; i++) {
-        file.getline(line, 256);
-        //cout << line << endl;
-    }
+/*
+ * Number requests by customer: the time windows of one customer are consecutive requests
+ */
+void buildCustomerIndex(ProblemInstance &);
+void buildKernelArrays(ProblemInstance &);
 
-    /*
-     * Read request: all parameter
-     */
-    //Read customer schedule
-    Request one_location;
+/*
+ * timeToward and costToward of the matrix, transposed by cache sized tiles
+ */
+void buildTransposes(TravelMatrix &);
 
-    string temp;
+/*
+ * Candidate neighbor lists of every location, see NeighborLists. buildNeighborMask
+ * fills allowed from the lists
+ */
+void buildNeighborLists(ProblemInstance &, int k);
+void buildNeighborMask(ProblemInstance &);
+int temporalDistance(const ProblemInstance &, int src, int dst);
 
-    //Depot
-    file >> one_location.customer_id >> one_location.demand >> one_location.location_id >> temp;
-    one_location.inRoute = false;
-    one_location.timeWindow.open = stoi(temp.substr(1, temp.find(",") - 1));
-    one_location.timeWindow.close = stoi(temp.substr(temp.find(",") + 1, temp.length() - temp.find(",")));
-    //cout << one_location.customer_id << " " << one_location.demand << " " << one_location.location_id << " [" << one_location.timeWindow.open << ", " << one_location.timeWindow.close << "]" << endl;
-    requests.push_back(one_location);
+/*
+ * Binary instance cache: load fails on missing, stale or corrupted cache
+ */
+bool loadBinaryInstance(string, const struct stat &, ProblemInstance &);
+bool writeBinaryInstance(string, const struct stat &, const ProblemInstance &);
+BinaryLayout binaryLayout(uint32_t number_requests, uint32_t string_bytes, uint32_t neighbor_k);
+uint64_t fnv1a(const char *, size_t);
 
-    //Escape end line
-    file.getline(line, 256);
-    //cout << line;
+/*
+ * Single pass parser of the text format into instance, used by readData on the mapped file.
+ * The scan helpers never allocate and never cross a line end unless told to
+ */
+bool parseInstance(TextScanner &, ProblemInstance &);
+void skipSpaces(TextScanner &);
+void skipWhitespace(TextScanner &);
+void skipLine(TextScanner &);
+bool atLineEnd(TextScanner &);
+bool expectChar(TextScanner &, char);
+bool scanInt(TextScanner &, int &);
+bool scanFloat(TextScanner &, float &);
+string_view scanToken(TextScanner &);
 
-    //Location 1->number of location
-    string line_s;
-    string customer_id;
-    int demand;
+/*
+ * Attach a solver to instance: fresh copy of requests, random engine seeded with seed,
+ * default configuration
+ */
+void initSolver(Solver &, const ProblemInstance &, unsigned seed);
 
+/*
+ * Configuration: defaults, one key=value setting, a file of settings (# comments) and
+ * the command line options shared by all modes. Errors are reported on cerr
+ * @return false on unknown key, bad value or unreadable file
+ */
+Config defaultConfig();
+bool setConfig(Config &, const string & key, const string & value);
+bool readConfig(Config &, string path);
+bool checkConfig(const Config &);
 
-    for (int i = 0; i <= parameters.number_customers; i++) {
-        file.getline(line, 256);
-        line_s = string(line);
-        //cout << endl << line << endl;
-        customer_id = line_s.substr(0, line_s.find_first_of(" "));
-        line_s.erase(0, line_s.find_first_of(" "));
-        while (line_s[0] == ' ') {
-            line_s.erase(0, 1);
-        }
+/*
+ * Parse the configuration option at argv[i]
+ * @return number of arguments used, 0 when argv[i] is not a configuration option, -1 on error
+ */
+int parseConfigOption(Config &, int argc, char * argv[], int i);
 
-        demand = stoi(line_s.substr(0, line_s.find_first_of("\t")));
-        line_s.erase(0, line_s.find_first_of("\t"));
-        while (line_s[0] == '\t') {
-            line_s.erase(0, 1);
-        }
+/*
+ * Index drawn with probability proportional to weights[index]
+ */
+int pickWeighted(mt19937 &, const float * weights, int number);
 
-        while (line_s.length() >= 5) {
-            one_location.customer_id = customer_id;
-            one_location.demand = demand;
-            one_location.location_id = line_s.substr(0, line_s.find_first_of(" "));
-            line_s.erase(0, line_s.find_first_of(" "));
-            while (line_s[0] == ' ') {
-                line_s.erase(0, 1);
-            }
+/*
+ * Adaptive operator selection, see OperatorStats. initOperators resets both families
+ * from solver.config, adaptWeights closes a segment of a family
+ */
+void initOperators(Solver &);
+void initOperatorStats(OperatorStats &, const vector < string > & names, const float * weights);
+void recordOperator(OperatorStats &, int op, double gain, double milliseconds);
+void adaptWeights(OperatorStats &, float reaction);
+void mergeOperatorStats(OperatorStats & into, const OperatorStats & from);
+void displayOperators(const string & title, const OperatorStats &);
 
-            temp = line_s.substr(0, line_s.find_first_of("\t"));
-            line_s.erase(0, line_s.find_first_of("\t"));
-            while (line_s[0] == '\t') {
-                line_s.erase(0, 1);
-            }
+/*
+ * Replace solution and inRoute flags of solver, e.g. by a copy from another solver
+ */
+void loadSolution(Solver &, const vector < Technician > &, const vector < Request > &);
 
-            one_location.inRoute = false;
-            one_location.timeWindow.open = stoi(temp.substr(1, temp.find_first_of(",") - 1));
-            one_location.timeWindow.close = stoi(temp.substr(temp.find(",") + 1, temp.length() - temp.find(",")));
-            //cout << one_location.customer_id << " " << one_location.demand << " " << one_location.location_id << " [" << one_location.timeWindow.open << ", " << one_location.timeWindow.close << "]" << endl;
-            requests.push_back(one_location);
-        }
-    }
+/*
+ * Location -> (route, position) index of the solution, kept up to date by insertToRoute,
+ * removeLocations and rollbackJournal. indexRoute refreshes positions of a route from a position
+ */
+void indexSolution(Solver &, const vector < Technician > &);
+void indexRoute(Solver &, const vector < Technician > &, int route, int from);
 
-    //Read end line, title
-    for (int i = 0; i < 4; i++) {
-        file.getline(line, 256);
-    }
+/*
+ * Batch removal used by every removal operator: mark all locations, then compact each
+ * affected route and its schedule vectors in one pass from its first removed position
+ * (positionOf) and recompute its schedule once
+ */
+void removeLocations(Solver &, vector < Technician > &, const vector < int > & locations);
 
-    //Read location coordinate
-    int location_id;
-    for (int i = 0; i < parameters.number_locations; i++) {
-        file >> location_id >> requests[i].coordinate.x >> requests[i].coordinate.y;
-        //cout << location_id << " " << request[i].coordinate.x << " " << request[i].coordinate.y << endl;
-    }
-
-    //Read end line, title
-    for (int i = 0; i < 5; i++) {
-        file.getline(line, 256);
-        //cout << line << endl;
-    }
-
-    //Read Travel time matrix to global variable: travelTimeMatrix
-    string src;
-    string dst;
-    while (!file.eof()) {
-        file.getline(line, 256);
-        //cout << "Line:str " <<  line << endl;
-        line_s = string(line);
-        if (line_s.length() == 0) {
-            break;
-        }
+/*
+ * Put or take all locations of a customer in route, the unassigned set follows
+ */
+void setCustomerInRoute(Solver &, int customer, bool);
+void markCustomer(Solver &, int customer, bool);
+void initUnassigned(Solver &);
 
-        src = line_s.substr(1, line_s.find(',') - 1);
-        dst = line_s.substr(line_s.find(',') + 2, line_s.find(')') - line_s.find(',') - 2);
-        line_s.erase(0, line_s.find(')') + 2);
+/*
+ * Initial Technician: insert depot to zero
+ */
+void initTechnician(Solver &, vector < Technician > &);
 
-        travelTimeMatrix[src][dst].time = stoi(line_s.substr(0, line_s.find(" ")));
-        travelTimeMatrix[src][dst].cost = stoi(line_s.substr(line_s.find(" "), line_s.length() - line_s.find(" ")));
+/*
+ * Check all request in route
+ * @return true if all request in Route
+ */
+bool checkAllRequest(const Solver &);
 
-        //cout << "(" << src << ", " << dst << ") ";
-        //cout << travelTimeMatrix[src][dst].time << " " << travelTimeMatrix[src][dst].cost << endl;
-    }
+/*
+ * Customer that fits no vehicle: no location of it can be inserted in the empty route
+ * @return index of the customer, -1 when every customer can be served
+ */
+int unservableCustomer(const ProblemInstance &, const Technician & empty);
 
-    //Calcualte distance
-    for(int i = 0; i < requests.size(); i++){
-        for(int j = 0; j < requests.size(); j++){
-            travelTimeMatrix[requests[i].location_id][requests[j].location_id].distancne = calculateDistance(requests[i].coordinate, requests[j].coordinate);
+/*
+ * Display route for problem
+ */
+void displayRoute(const ProblemInstance &, const vector < Technician > &);
+
+/*
+ *  Algorithm insert request to Route
+ */
+void firstInsertion(Solver &, vector < Technician > &);
+void scoreInsertion(Solver &, vector < Technician > &);
+void greedyBasicInsertion(Solver &, vector < Technician > &);
+void regretInsertion(Solver &, vector < Technician > &, int k);
+
+/*
+ * k-regret insertion: insert first the request losing most when it cannot go to its best
+ * route, the regret being the sum over its 2nd..k-th best routes of the extra costDelta.
+ * A request with less than k feasible routes counts REGRET_MISSING per missing route.
+ * Empty routes all offer the same insertion, only one of them is ranked
+ */
+const float REGRET_MISSING = 1000000;
+void rankRegretRoutes(InsertionCache &, int request);
+void refreshRegretRoutes(Solver &, InsertionCache &, int route);
+
+/*
+ * Insert requests one by one at their best (route, position) following rule,
+ * recomputing cached candidates only for the route that received the request
+ */
+void bestInsertion(Solver &, vector < Technician > &, InsertionRule);
+
+/*
+ * Insert the request of a BestPair at its position, then update the schedule of its route
+ */
+void applyInsertion(Solver &, vector < Technician > &, const BestPair &);
+void initInsertionCache(Solver &, InsertionCache &, InsertionRule, vector < Technician > &);
+void evaluateRouteInsertions(Solver &, InsertionCache &, int route, vector < Technician > &);
+void refreshInsertionCache(Solver &, InsertionCache &, int route, vector < Technician > &);
+
+/*
+ * Insertion kernel: best insertion of requests [begin, end) into every position of one route,
+ * kept in the KernelScratch arrays. Same result as evaluateInsertion + insertionRatio per
+ * position; the AVX2 version takes 8 requests at a time and is picked at run time
+ */
+void scoreInsertions(const ProblemInstance &, const Technician &, InsertionRule, bool granular, KernelScratch &, int number);
+void scoreInsertionsScalar(const ProblemInstance &, const Technician &, InsertionRule, bool granular, KernelScratch &, int begin, int end);
+#ifdef __x86_64__
+void scoreInsertionsAvx2(const ProblemInstance &, const Technician &, InsertionRule, bool granular, KernelScratch &, int number);
+#endif
+
+/*
+ * Insertion Step in ILS
+ * @return insertion operator used
+ */
+int insertionStep(Solver &, vector < Technician > &);
+
+/*
+ * Update parameter after remove list request
+ */
+void updateAfterErase(const ProblemInstance &, Technician &);
+
+/*
+ * Remove location_is from vehicle with a customer
+ */
+void fixRequestInRoute(Solver &, int customer);
+
+/*
+ * Undo log: every change of a route or of an inRoute flag during an iteration goes
+ * through touchRoute/setInRoute, rollbackJournal restores the solution as it was at beginJournal
+ */
+void beginJournal(Solver &, vector < Technician > &);
+void touchRoute(Solver &, vector < Technician > &, int route);
+void setInRoute(Solver &, int request, bool);
+void commitJournal(Solver &);
+void rollbackJournal(Solver &, vector < Technician > &);
+
+/*
+ * Algorithm removal
+ */
+void randomRemoval(Solver &, vector < Technician > &, int);
+void worstRemoval(Solver &, vector < Technician > &, int, float);
+void shawRemoval(Solver &, vector < Technician > &, int, float);
+void time_orientedRemoval(Solver &, vector < Technician > &, int, float);
+
+/*
+ * Calculate shaw score for shaw removal, lower is more related
+ */
+void initRelatedness(Relatedness &, int number_location, const vector < Technician > &);
+int calculateShawScore(const ProblemInstance &, const Relatedness &, int location_1, int location_2);
+
+/*
+ * Index in candidates of the location of rank x by shaw score to r, candidates are reordered
+ */
+int selectRelated(const ProblemInstance &, const Relatedness &, int r, vector < RequestAndScore > & candidates, int x);
+
+/*
+ * Shaking step in ILS
+ * @return removal operator used
+ */
+int shakingStep(Solver &, vector < Technician > &);
+
+/*
+ * Local search after repair, first improvement until no move improves the cost or the
+ * search deadline passes: inter-route relocate and Or-opt (segments of 1..3 locations),
+ * swap and 2-opt* from every routed location in turn, then intra-route Or-opt and 2-opt.
+ * Inter-route moves only create arcs to the nearest and compatible neighbors of the
+ * location (found with routeOf and positionOf) or open one empty route, and the scan goes
+ * on from the improved location instead of restarting. A move delays the successor of each
+ * new arc by delta, feasible when delta <= waitTime + maxShift there: maxShift only depends
+ * on the suffix, so inter-route moves are checked in O(1), intra-route ones re-time the
+ * changed span only
+ * @return cost improvement
+ */
+int localSearch(Solver &, vector < Technician > &);
+bool relocateMove(Solver &, vector < Technician > &, int location);
+bool swapMove(Solver &, vector < Technician > &, int location);
+bool twoOptStarMove(Solver &, vector < Technician > &, int location);
+bool intraRouteMove(Solver &, vector < Technician > &, int route);
+
+/*
+ * Feasibility helpers of local search. delayFits: arrival at route[pos] may become arrival.
+ * timeSequence: start time at the last of count locations (read with step) visited after prev
+ * started at startPrev, -1 when a time window is missed. retimeRoute: visits equals the
+ * route of _tech from rejoin on, re-time visits from first and check the delay at rejoin
+ */
+bool delayFits(const Technician &, int pos, int arrival);
+int timeSequence(const ProblemInstance &, int prev, int startPrev, const int * locations, int count, int step);
+bool retimeRoute(const ProblemInstance &, const Technician &, const vector < int > & visits, int first, int rejoin);
+
+/*
+ * Replace the visits of a route and rebuild its load, schedule and position index
+ */
+void setRoute(Solver &, vector < Technician > &, int route, const vector < int > & visits);
+
+/*
+ * Heristic of ILS, runs until a limit of solver.config
+ * @return number of iterations done
+ */
+int heuristic(Solver &, vector < Technician > &);
+int iterateHeuristic(Solver &, vector < Technician > &, int number_iteration);
+void startSearch(Solver &);
+bool searchStopped(const Solver &);
+
+/*
+ * ILS on options.number_thread threads, each with its own random engine and solution copy,
+ * its configuration and deadline taken from the solver
+ */
+int parallelHeuristic(Solver &, vector < Technician > &, ParallelOptions, unsigned seed);
+void runTrajectory(SharedBest &, const Solver &, vector < Technician >, ParallelOptions, unsigned seed, int trajectory);
+
+/*
+ * Convergence trace: openTrace truncates path and writes the CSV header, traceIteration
+ * buffers one line and writes the buffer once it passes TRACE_BUFFER_SIZE, flushTrace
+ * writes what is left. Nothing is traced while solver.trace is NULL
+ */
+bool openTrace(TraceWriter &, string path);
+void traceIteration(Solver &, int cost, int best, int removal, int insertion, int removed);
+void flushTrace(Solver &);
+
+/*
+ * Creat inittial solution
+ */
+void initSolution(Solver &, vector < Technician > &);
+
+/*
+ * Batch mode: instance files of a directory or glob pattern, sorted by path
+ */
+vector < string > listInstances(string);
+
+/*
+ * Batch mode: solve one instance file with its own instance, solver and seed
+ */
+InstanceResult solveInstance(string path, const Config &, unsigned seed, TraceWriter *, int run);
+
+/*
+ * Batch mode: solve paths on number_worker threads, one JSON line per instance
+ * written to output as soon as it is solved
+ */
+void runBatch(const vector < string > &, int number_worker, const Config &, unsigned seed, ostream &, TraceWriter *);
+void writeResult(ostream &, const InstanceResult &);
+void writeOperators(ostream &, const OperatorStats &);
+string jsonString(const string &);
+
+/*
+ * Instrumentation dump: timers (calls, total and mean time) and counters of all threads
+ * as one JSON object, see ProfileTimer. Only with VRP_PROFILE
+ */
+#ifdef VRP_PROFILE
+void writeProfile(ostream &);
+void dumpProfile(string path);
+#endif
+
+
+
+#ifndef VRP_NO_MAIN
+int main(int argc, char * argv[]) {
+    unsigned seed = time(NULL);
+    Config config = defaultConfig();
+    int used;
+
+    if(argc > 1 && string(argv[1]) == "--batch"){
+        //VRP --batch <directory|glob> [--workers N] [--output results.jsonl] [--trace FILE] [configuration options]
+        if(argc < 3){
+            cout << "Usage: " << argv[0] << " --batch <directory|glob> [--workers N] [--output FILE] [--trace FILE] [configuration options]" << endl;
+            return 1;
+        }
+        int number_worker = maxOf(1, thread::hardware_concurrency());
+        string output_path = "results.jsonl";
+        string trace_path;
+        for(int i = 3; i < argc; i += used){
+            used = parseConfigOption(config, argc, argv, i);
+            if(used < 0){
+                return 1;
+            }
+            if(used > 0){
+                continue;
+            }
+            used = 2;
+            if(string(argv[i]) == "--workers" && i + 1 < argc){
+                const char * value = argv[i + 1];
+                from_chars_result parsed = from_chars(value, value + strlen(value), number_worker);
+                if(parsed.ec != errc() || *parsed.ptr != '\0' || number_worker < 1){
+                    cerr << "Bad value for --workers: " << value << endl;
+                    return 1;
+                }
+            }else if(string(argv[i]) == "--output" && i + 1 < argc){
+                output_path = argv[i + 1];
+            }else if(string(argv[i]) == "--trace" && i + 1 < argc){
+                trace_path = argv[i + 1];
+            }else{
+                cerr << "Unknown option " << argv[i] << endl;
+                return 1;
+            }
+        }
+        if(!checkConfig(config)){
+            return 1;
+        }
+
+        vector < string > paths = listInstances(argv[2]);
+        cout << "VRPRD batch: " << paths.size() << " instances on " << number_worker << " workers" << endl;
+        TraceWriter trace;
+        if(!trace_path.empty() && !openTrace(trace, trace_path)){
+            return 1;
+        }
+        ofstream output(output_path);
+        if(!output){
+            cerr << "Cannot write results " << output_path << endl;
+            return 1;
+        }
+        runBatch(paths, number_worker, config, seed, output, trace_path.empty() ? NULL : &trace);
+        cout << "VRPRD batch success, results in " << output_path << endl;
+#ifdef VRP_PROFILE
+        dumpProfile("profile.json");
+#endif
+        return 0;
+    }
+
+    if(argc > 1 && string(argv[1]) == "--generate"){
+        //VRP --generate <output.txt> [--customers N] [--windows W] [--horizon H] [--tightness T] [--capacity C] [--seed S]
+        if(argc < 3){
+            cout << "Usage: " << argv[0] << " --generate <output.txt> [--customers N] [--windows W] [--horizon H] [--tightness T] [--capacity C] [--seed S]" << endl;
+            return 1;
+        }
+        GeneratorOptions options = defaultGeneratorOptions();
+        for(int i = 3; i < argc; i += 2){
+            string option = argv[i];
+            if(option != "--customers" && option != "--windows" && option != "--horizon" && option != "--tightness"
+               && option != "--capacity" && option != "--seed"){
+                cerr << "Unknown option " << option << endl;
+                return 1;
+            }
+            if(i + 1 >= argc){
+                cerr << "Missing value for " << option << endl;
+                return 1;
+            }
+
+            //Same checks as setConfig: a whole finite number, in range, counts are integers
+            const char * value = argv[i + 1];
+            const char * end = value + strlen(value);
+            double number = 0;
+            from_chars_result parsed = option == "--seed" ? from_chars(value, end, seed) : from_chars(value, end, number);
+            bool ok = parsed.ec == errc() && parsed.ptr == end && isfinite(number);
+            if(option == "--tightness"){
+                ok = ok && number >= 0 && number <= 1;
+            }else if(option != "--seed"){
+                ok = ok && number == floor(number) && number >= (option == "--horizon" ? 8 : 1) && number <= INT_MAX;
+            }
+            if(!ok){
+                cerr << "Bad value for " << option << ": " << value << endl;
+                return 1;
+            }
+
+            if(option == "--customers"){
+                options.number_customers = int(number);
+            }else if(option == "--windows"){
+                options.windows_per_customer = int(number);
+            }else if(option == "--horizon"){
+                options.time_horizon = int(number);
+            }else if(option == "--tightness"){
+                options.tightness = number;
+            }else if(option == "--capacity"){
+                options.vehicle_capacity = int(number);
+            }
+        }
+
+        ProblemInstance instance;
+        generateInstance(instance, options, seed);
+        if(!writeInstance(argv[2], instance)){
+            cerr << "Cannot write " << argv[2] << endl;
+            return 1;
+        }
+        cout << "VRPRD generate: " << options.number_customers << " customers, " << instance.requests.size()
+             << " locations, seed " << seed << " in " << argv[2] << endl;
+        return 0;
+    }
+
+    int number_intance = 5;
+
+    ParallelOptions parallelOptions;
+    parallelOptions.number_thread = 1;
+
+    string trace_path;
+
+    //VRP [number_thread] [--trace FILE] [configuration options]
+    for(int i = 1; i < argc; i += used){
+        used = parseConfigOption(config, argc, argv, i);
+        if(used < 0){
+            return 1;
+        }
+        if(used > 0){
+            continue;
+        }
+        used = 1;
+        if(i == 1 && isdigit(static_cast<unsigned char>(argv[i][0]))){
+            const char * value = argv[i];
+            from_chars_result parsed = from_chars(value, value + strlen(value), parallelOptions.number_thread);
+            if(parsed.ec != errc() || *parsed.ptr != '\0' || parallelOptions.number_thread < 1){
+                cerr << "Bad value for number_thread: " << value << endl;
+                return 1;
+            }
+        }else if(string(argv[i]) == "--trace" && i + 1 < argc){
+            trace_path = argv[i + 1];
+            used = 2;
+        }else{
+            cerr << "Unknown option " << argv[i] << endl;
+            return 1;
+        }
+    }
+    if(!checkConfig(config)){
+        return 1;
+    }
+    parallelOptions.exchange_interval = config.exchange_interval;
+    parallelOptions.restart_lagging = config.restart_gap > 0;
+    parallelOptions.restart_gap = config.restart_gap;
+    TraceWriter trace;
+    if(!trace_path.empty() && !openTrace(trace, trace_path)){
+        return 1;
+    }
+
+    const clock_t begin_time = clock();
+    cout << "VRPRD start..." << endl;
+
+    string path;
+
+    for(int i = 0; i < number_intance; i++){
+
+        cout << "+)Intance " << i << " start..." << endl;
+
+        const clock_t begin_time_intance = clock();
+        path = "instance/instance_" + to_string(i) + "-triangle.txt";
+        ProblemInstance instance;
+        Solver solver;
+        vector < Technician > solution(0);
+        if(!readData(path, instance)){
+            cerr << "Cannot read instance " << path << endl;
+            return 1;
+        }
+        initSolver(solver, instance, seed + i);
+        solver.config = config;
+        solver.trace = trace_path.empty() ? NULL : &trace;
+        solver.traceRun = i;
+        initSolution(solver, solution);
+        cout << "\tCreate initial solution success." << endl;
+        cout << "\tImprove solution..." << endl;
+        int iterations;
+        if(parallelOptions.number_thread > 1){
+            iterations = parallelHeuristic(solver, solution, parallelOptions, seed + i);
+        }else{
+            iterations = heuristic(solver, solution);
+        }
+        cout << "\t" << iterations << " iterations" << endl;
+        displayOperators("Removal", solver.removal);
+        displayOperators("Insertion", solver.insertion);
+        displayRoute(instance, solution);
+
+        cout << "\t=> Intance " << i << " success in " << float(clock() - begin_time_intance) << endl;
+        break;
+    }
+
+    cout << "Spend total time: " << float( clock() - begin_time) / CLOCKS_PER_SEC << endl;
+#ifdef VRP_PROFILE
+    dumpProfile("profile.json");
+#endif
+    cout << "VRPRD success!!!" << endl;
+    return 0;
+}
+#endif
+
+/*
+ * Area Define function
+ */
+
+int maxOf(int num1, int num2){
+    if(num1 > num2){
+        return num1;
+    }else{
+        return num2;
+    }
+}
+
+int minOf(int num1, int num2){
+    if(num1 < num2){
+        return num1;
+    }else{
+        return num2;
+    }
+}
+
+float calculateDistance(Coordinate visit1, Coordinate visit2) {
+    return float(sqrt(pow(visit1.x - visit2.x, 2.0) + pow(visit1.y - visit2.y, 2.0)));
+}
+
+int calculateShift(const TravelMatrix & matrix, const Request & _request, const Technician & _tech, int pos) {
+    return travelTime(matrix, _tech.route[pos-1], _request.location)
+           + calculateWaitTime(matrix, _request, _tech, pos)
+           + travelTime(matrix, _request.location, _tech.route[pos])
+           - travelTime(matrix, _tech.route[pos-1], _tech.route[pos]);
+}
+
+int calculateArrivingTime(const TravelMatrix & matrix, const Request & _request, const Technician & _tech, int pos){
+    return _tech.startTime[pos-1] + travelTime(matrix, _tech.route[pos-1], _request.location);
+}
+
+int calculateWaitTime(const TravelMatrix & matrix, const Request & _request, const Technician & _tech, int pos){
+    return maxOf(0, _request.timeWindow.open - calculateArrivingTime(matrix, _request, _tech, pos));
+}
+
+int calculateMaxShift(const Request & _request, const Technician & _tech, int pos){
+    return minOf(_request.timeWindow.close - _tech.startTime[pos], _tech.waitTime[pos+1] + _tech.maxShift[pos+1]);
+}
+
+int calculateStartTime(const TravelMatrix & matrix, const Request & _request, const Technician & _tech, int pos){
+    return maxOf(_request.timeWindow.open, _tech.startTime[pos-1] + travelTime(matrix, _tech.route[pos-1], _request.location));
+}
+
+float calculateRatio(int shift, float cost){
+    //Formulate for ratio ?
+    //return 100.0 / (shift * shift + cost);
+    //return 100.0 / shift;
+    return 100.0 / (shift * cost); //best
+    //return 100.0 / (shift + cost);
+    //return 100.0 / ((shift + cost)*cost);
+    //return 100.0 / (shift * shift * cost);
+    //return 100.0 / (shift * pow(cost, 4.0));
+}
+
+InsertionCandidate evaluateInsertion(const ProblemInstance & instance, const Request & _request, const Technician & _tech, int pos){
+    const TravelMatrix & matrix = instance.matrix;
+    InsertionCandidate candidate;
+    candidate.feasible = false;
+
+    if(_request.inRoute || _request.demand + _tech.usedSize > instance.parameters.vehicle_capacity){
+        return candidate;
+    }
+
+    int prev = _tech.route[pos-1];
+    int next = _tech.route[pos];
+    int timeToRequest = travelTime(matrix, prev, _request.location);
+
+    candidate.arrivingTime = _tech.startTime[pos-1] + timeToRequest;
+    if(_request.timeWindow.close <= candidate.arrivingTime){
+        return candidate;
+    }
+
+    candidate.waitTime = maxOf(0, _request.timeWindow.open - candidate.arrivingTime);
+    candidate.shift = timeToRequest + candidate.waitTime + travelTime(matrix, _request.location, next) - travelTime(matrix, prev, next);
+    if(candidate.shift > _tech.waitTime[pos] + _tech.maxShift[pos]){
+        return candidate;
+    }
+
+    candidate.cost = travelCost(matrix, prev, _request.location) + travelCost(matrix, _request.location, next);
+    candidate.costDelta = candidate.cost - travelCost(matrix, prev, next);
+    candidate.feasible = true;
+    return candidate;
+}
+
+void insertToRoute(Solver & solver, Request & _request, int pos, vector < Technician > & solution, int route, int shift){
+    const TravelMatrix & matrix = solver.instance->matrix;
+    Technician & _tech = solution[route];
+    //Update all position of customer in route
+    setCustomerInRoute(solver, _request.customer, true);
+
+    _tech.route.insert(_tech.route.begin() + pos, _request.location);
+    _tech.shift.insert(_tech.shift.begin() + pos, shift);
+    _tech.waitTime.insert(_tech.waitTime.begin() + pos, calculateWaitTime(matrix, _request, _tech, pos));
+    _tech.arrivingTime.insert(_tech.arrivingTime.begin() + pos, calculateArrivingTime(matrix, _request, _tech, pos));
+    _tech.startTime.insert(_tech.startTime.begin() + pos, maxOf(_request.timeWindow.open, _tech.arrivingTime[pos]));
+    _tech.maxShift.insert(_tech.maxShift.begin() + pos, 0);
+
+    _tech.usedSize += _request.demand;
+    indexRoute(solver, solution, route, pos);
+}
+
+void indexSolution(Solver & solver, const vector < Technician > & solution){
+    solver.routeOf.assign(solver.requests.size(), -1);
+    solver.positionOf.assign(solver.requests.size(), -1);
+    for(int route = 0; route < solution.size(); route++){
+        indexRoute(solver, solution, route, 1);
+    }
+}
+
+void indexRoute(Solver & solver, const vector < Technician > & solution, int route, int from){
+    const vector < int > & visits = solution[route].route;
+    for(int pos = maxOf(from, 1); pos < int(visits.size()) - 1; pos++){
+        solver.routeOf[visits[pos]] = route;
+        solver.positionOf[visits[pos]] = pos;
+    }
+}
+
+void removeLocations(Solver & solver, vector < Technician > & solution, const vector < int > & locations){
+    vector < int > changed;
+    vector < int > firstRemoved;    //lowest position removed in each changed route
+    int route;
+    size_t index;
+
+    //Mark: routeOf -1 tells the compaction to drop the location
+    for(int location: locations){
+        route = solver.routeOf[location];
+        if(route == -1){
+            continue;
+        }
+        index = find(changed.begin(), changed.end(), route) - changed.begin();
+        if(index == changed.size()){
+            touchRoute(solver, solution, route);
+            changed.push_back(route);
+            firstRemoved.push_back(solver.positionOf[location]);
+        }else{
+            firstRemoved[index] = minOf(firstRemoved[index], solver.positionOf[location]);
+        }
+        solution[route].usedSize -= solver.requests[location].demand;
+        fixRequestInRoute(solver, solver.requests[location].customer);
+        solver.routeOf[location] = -1;
+        solver.positionOf[location] = -1;
+    }
+
+    //Compact: depots stay at both ends, schedule vectors move with the route,
+    //visits before the first removed position stay in place
+    for(index = 0; index < changed.size(); index++){
+        int route = changed[index];
+        Technician & _tech = solution[route];
+        int last = _tech.route.size() - 1;
+        int kept = firstRemoved[index];
+        for(int pos = firstRemoved[index]; pos < last; pos++){
+            if(solver.routeOf[_tech.route[pos]] == -1){
+                continue;
+            }
+            _tech.route[kept] = _tech.route[pos];
+            _tech.waitTime[kept] = _tech.waitTime[pos];
+            _tech.shift[kept] = _tech.shift[pos];
+            _tech.maxShift[kept] = _tech.maxShift[pos];
+            _tech.arrivingTime[kept] = _tech.arrivingTime[pos];
+            _tech.startTime[kept] = _tech.startTime[pos];
+            kept++;
+        }
+        _tech.route[kept] = _tech.route[last];
+        _tech.waitTime[kept] = _tech.waitTime[last];
+        _tech.shift[kept] = _tech.shift[last];
+        _tech.maxShift[kept] = _tech.maxShift[last];
+        _tech.arrivingTime[kept] = _tech.arrivingTime[last];
+        _tech.startTime[kept] = _tech.startTime[last];
+        kept++;
+        _tech.route.resize(kept);
+        _tech.waitTime.resize(kept);
+        _tech.shift.resize(kept);
+        _tech.maxShift.resize(kept);
+        _tech.arrivingTime.resize(kept);
+        _tech.startTime.resize(kept);
+
+        //Recompute schedule
+        indexRoute(solver, solution, route, firstRemoved[index]);
+        updateAfterErase(*solver.instance, _tech);
+    }
+}
+
+void initSolver(Solver & solver, const ProblemInstance & instance, unsigned seed){
+    solver.instance = &instance;
+    solver.requests = instance.requests;
+    solver.rng.seed(seed);
+    solver.journal.active = false;
+    solver.journal.numberSaved = 0;
+    solver.config = defaultConfig();
+    solver.noImprovement = 0;
+    initOperators(solver);
+    solver.routeOf.assign(solver.requests.size(), -1);
+    solver.positionOf.assign(solver.requests.size(), -1);
+    solver.moveScratch.loadBefore.assign(solver.requests.size(), 0);
+    initUnassigned(solver);
+    solver.trace = NULL;
+    solver.traceRun = 0;
+    solver.traceIteration = 0;
+}
+
+void loadSolution(Solver & solver, const vector < Technician > & solution, const vector < Request > & requests){
+    solver.requests = requests;
+    initUnassigned(solver);
+    indexSolution(solver, solution);
+}
+
+Config defaultConfig(){
+    Config config;
+    config.number_iteration = 5000;
+    config.time_limit = 0;
+    config.no_improvement_limit = 0;
+    config.erase_min = 4;
+    config.erase_max_ratio = 2.0 / 3;
+    config.worst_p = 2.5;
+    config.shaw_p = 0;
+    config.removal_weight[0] = config.removal_weight[1] = config.removal_weight[2] = 1;
+    config.insertion_weight[0] = config.insertion_weight[1] = 1;
+    config.insertion_weight[2] = config.insertion_weight[3] = 1;
+    config.granular = false;
+    config.adaptive = false;
+    config.adaptive_segment = 100;
+    config.adaptive_reaction = 0.2;
+    config.local_search = true;
+    config.exchange_interval = 250;
+    config.restart_gap = 0.05;
+    return config;
+}
+
+bool setConfig(Config & config, const string & key, const string & value){
+    const char * begin = value.data();
+    const char * end = value.data() + value.size();
+    from_chars_result parsed;
+    double number = 0;
+
+    //Every setting is a finite number, granular is 0 or 1. from_chars accepts nan and inf
+    parsed = from_chars(begin, end, number);
+    if(parsed.ec != errc() || parsed.ptr != end || !isfinite(number) || number < 0){
+        cerr << "Bad value for " << key << ": " << value << endl;
+        return false;
+    }
+    //Counts are stored as int
+    if(number > INT_MAX){
+        cerr << "Value out of range [0, " << INT_MAX << "] for " << key << ": " << value << endl;
+        return false;
+    }
+
+    if(key == "iterations"){
+        config.number_iteration = int(number);
+    }else if(key == "time_limit"){
+        config.time_limit = number;
+    }else if(key == "no_improvement"){
+        config.no_improvement_limit = int(number);
+    }else if(key == "erase_min"){
+        config.erase_min = maxOf(1, int(number));
+    }else if(key == "erase_max_ratio"){
+        config.erase_max_ratio = number;
+    }else if(key == "worst_p"){
+        config.worst_p = number;
+    }else if(key == "shaw_p"){
+        config.shaw_p = number;
+    }else if(key == "removal_random"){
+        config.removal_weight[0] = number;
+    }else if(key == "removal_worst"){
+        config.removal_weight[1] = number;
+    }else if(key == "removal_shaw"){
+        config.removal_weight[2] = number;
+    }else if(key == "insertion_score"){
+        config.insertion_weight[0] = number;
+    }else if(key == "insertion_greedy"){
+        config.insertion_weight[1] = number;
+    }else if(key == "insertion_regret2"){
+        config.insertion_weight[2] = number;
+    }else if(key == "insertion_regret3"){
+        config.insertion_weight[3] = number;
+    }else if(key == "granular"){
+        config.granular = number != 0;
+    }else if(key == "adaptive"){
+        config.adaptive = number != 0;
+    }else if(key == "adaptive_segment"){
+        config.adaptive_segment = maxOf(1, int(number));
+    }else if(key == "adaptive_reaction"){
+        config.adaptive_reaction = min(1.0, number);
+    }else if(key == "local_search"){
+        config.local_search = number != 0;
+    }else if(key == "exchange_interval"){
+        config.exchange_interval = maxOf(1, int(number));
+    }else if(key == "restart_gap"){
+        config.restart_gap = number;
+    }else{
+        cerr << "Unknown configuration key " << key << endl;
+        return false;
+    }
+    return true;
+}
+
+bool readConfig(Config & config, string path){
+    ifstream input(path);
+    if(!input){
+        cerr << "Cannot read configuration " << path << endl;
+        return false;
+    }
+
+    string line;
+    size_t separator;
+    int number_line = 0;
+    while(getline(input, line)){
+        number_line++;
+        line = line.substr(0, line.find('#'));
+        line.erase(remove_if(line.begin(), line.end(), [](char c){ return isspace(static_cast<unsigned char>(c)); }), line.end());
+        if(line.empty()){
+            continue;
+        }
+        separator = line.find('=');
+        if(separator == string::npos){
+            cerr << path << ":" << number_line << ": expected key=value" << endl;
+            return false;
+        }
+        if(!setConfig(config, line.substr(0, separator), line.substr(separator + 1))){
+            return false;
+        }
+    }
+    return true;
+}
+
+bool checkConfig(const Config & config){
+    if(config.number_iteration == 0 && config.time_limit == 0 && config.no_improvement_limit == 0){
+        cerr << "Configuration has no stopping rule: set iterations, time_limit or no_improvement" << endl;
+        return false;
+    }
+    if(config.removal_weight[0] + config.removal_weight[1] + config.removal_weight[2] <= 0
+       || config.insertion_weight[0] + config.insertion_weight[1] + config.insertion_weight[2] + config.insertion_weight[3] <= 0){
+        cerr << "Configuration needs a removal and an insertion operator with positive weight" << endl;
+        return false;
+    }
+    return true;
+}
+
+int parseConfigOption(Config & config, int argc, char * argv[], int i){
+    string option = argv[i];
+    if(option == "--granular"){
+        config.granular = true;
+        return 1;
+    }
+    if(option == "--adaptive"){
+        config.adaptive = true;
+        return 1;
+    }
+
+    //Options with a value
+    string key;
+    if(option == "--iterations"){
+        key = "iterations";
+    }else if(option == "--time-limit"){
+        key = "time_limit";
+    }else if(option == "--no-improvement"){
+        key = "no_improvement";
+    }else if(option != "--config" && option != "--set"){
+        return 0;
+    }
+    if(i + 1 >= argc){
+        cerr << "Missing value for " << option << endl;
+        return -1;
+    }
+
+    string value = argv[i + 1];
+    bool ok;
+    if(option == "--config"){
+        ok = readConfig(config, value);
+    }else if(option == "--set"){
+        //--set key=value
+        size_t separator = value.find('=');
+        ok = separator != string::npos && setConfig(config, value.substr(0, separator), value.substr(separator + 1));
+        if(separator == string::npos){
+            cerr << "Expected key=value after --set" << endl;
+        }
+    }else{
+        ok = setConfig(config, key, value);
+    }
+    return ok ? 2 : -1;
+}
+
+int pickWeighted(mt19937 & rng, const float * weights, int number){
+    float total = 0;
+    for(int i = 0; i < number; i++){
+        total += weights[i];
+    }
+    float draw = randomUnit(rng) * total;
+    for(int i = 0; i < number; i++){
+        if(draw < weights[i]){
+            return i;
+        }
+        draw -= weights[i];
+    }
+
+    //Rounding left draw at total: last operator with a weight
+    for(int i = number - 1; i > 0; i--){
+        if(weights[i] > 0){
+            return i;
+        }
+    }
+    return 0;
+}
+
+void initOperators(Solver & solver){
+    initOperatorStats(solver.removal, {"random", "worst", "shaw"}, solver.config.removal_weight);
+    initOperatorStats(solver.insertion, {"score", "greedy", "regret2", "regret3"}, solver.config.insertion_weight);
+    solver.segmentIterations = 0;
+}
+
+void initOperatorStats(OperatorStats & stats, const vector < string > & names, const float * weights){
+    int number = names.size();
+    stats.name = names;
+    stats.weight.assign(weights, weights + number);
+    stats.calls.assign(number, 0);
+    stats.improvements.assign(number, 0);
+    stats.gain.assign(number, 0);
+    stats.time.assign(number, 0);
+    stats.segmentGain.assign(number, 0);
+    stats.segmentTime.assign(number, 0);
+}
+
+void recordOperator(OperatorStats & stats, int op, double gain, double milliseconds){
+    stats.calls[op]++;
+    stats.gain[op] += gain;
+    stats.time[op] += milliseconds;
+    stats.segmentGain[op] += gain;
+    stats.segmentTime[op] += milliseconds;
+    if(gain > 0){
+        stats.improvements[op]++;
+    }
+}
+
+void adaptWeights(OperatorStats & stats, float reaction){
+    int number = stats.weight.size();
+    vector < double > rate(number, 0);
+    double total = 0;
+    int enabled = 0;
+    for(int i = 0; i < number; i++){
+        if(stats.weight[i] > 0){
+            rate[i] = stats.segmentTime[i] > 0 ? stats.segmentGain[i] / stats.segmentTime[i] : 0;
+            total += rate[i];
+            enabled++;
+        }
+        stats.segmentGain[i] = 0;
+        stats.segmentTime[i] = 0;
+    }
+    if(total <= 0){
+        //No improvement in the segment: keep the weights
+        return;
+    }
+
+    //Rates scaled to a mean of 1, a floor keeps every enabled operator tried
+    for(int i = 0; i < number; i++){
+        if(stats.weight[i] > 0){
+            stats.weight[i] = (1 - reaction) * stats.weight[i] + reaction * rate[i] / total * enabled;
+            stats.weight[i] = max(stats.weight[i], 0.05f);
+        }
+    }
+}
+
+void mergeOperatorStats(OperatorStats & into, const OperatorStats & from){
+    if(into.name.empty()){
+        into = from;
+        return;
+    }
+    for(int i = 0; i < into.weight.size(); i++){
+        into.weight[i] += from.weight[i];
+        into.calls[i] += from.calls[i];
+        into.improvements[i] += from.improvements[i];
+        into.gain[i] += from.gain[i];
+        into.time[i] += from.time[i];
+    }
+}
+
+void displayOperators(const string & title, const OperatorStats & stats){
+    cout << "	" << title << " operators:" << endl;
+    for(int i = 0; i < stats.name.size(); i++){
+        cout << "		" << stats.name[i] << ": weight " << stats.weight[i]
+             << ", calls " << stats.calls[i] << ", improvements " << stats.improvements[i]
+             << ", gain " << stats.gain[i] << ", " << stats.time[i] << " ms";
+        if(stats.time[i] > 0){
+            cout << ", gain/ms " << stats.gain[i] / stats.time[i];
+        }
+        cout << endl;
+    }
+}
+
+void initUnassigned(Solver & solver){
+    const vector < int > & customerFirst = solver.instance->customerFirst;
+    int number_customer = int(customerFirst.size()) - 1;
+    solver.unassigned.clear();
+    solver.unassignedPos.assign(number_customer, -1);
+    for(int c = 0; c < number_customer; c++){
+        markCustomer(solver, c, solver.requests[customerFirst[c]].inRoute);
+    }
+}
+
+void markCustomer(Solver & solver, int customer, bool inRoute){
+    vector < int > & unassignedPos = solver.unassignedPos;
+    if(!inRoute && unassignedPos[customer] == -1){
+        unassignedPos[customer] = solver.unassigned.size();
+        solver.unassigned.push_back(customer);
+    }else if(inRoute && unassignedPos[customer] != -1){
+        //Move last customer into the hole
+        int last = solver.unassigned.back();
+        solver.unassigned[unassignedPos[customer]] = last;
+        unassignedPos[last] = unassignedPos[customer];
+        solver.unassigned.pop_back();
+        unassignedPos[customer] = -1;
+    }
+}
+
+void setCustomerInRoute(Solver & solver, int customer, bool inRoute){
+    const vector < int > & customerFirst = solver.instance->customerFirst;
+    for(int i = customerFirst[customer]; i < customerFirst[customer + 1]; i++){
+        setInRoute(solver, i, inRoute);
+    }
+    markCustomer(solver, customer, inRoute);
+}
+
+void beginJournal(Solver & solver, vector < Technician > & solution){
+    MoveJournal & journal = solver.journal;
+    journal.active = true;
+    journal.numberSaved = 0;
+    journal.savedRouteIds.clear();
+    journal.isSaved.assign(solution.size(), false);
+    journal.flippedRequests.clear();
+    journal.flippedValues.clear();
+}
+
+void touchRoute(Solver & solver, vector < Technician > & solution, int route){
+    MoveJournal & journal = solver.journal;
+    if(!journal.active || journal.isSaved[route]){
+        return;
+    }
+    journal.isSaved[route] = true;
+    journal.savedRouteIds.push_back(route);
+    if(journal.numberSaved == journal.savedRoutes.size()){
+        journal.savedRoutes.push_back(solution[route]);
+    }else{
+        //Assignment reuses the capacity left by an older iteration
+        journal.savedRoutes[journal.numberSaved] = solution[route];
+    }
+    journal.numberSaved++;
+}
+
+void setInRoute(Solver & solver, int request, bool inRoute){
+    if(solver.requests[request].inRoute == inRoute){
+        return;
+    }
+    if(solver.journal.active){
+        solver.journal.flippedRequests.push_back(request);
+        solver.journal.flippedValues.push_back(solver.requests[request].inRoute);
+    }
+    solver.requests[request].inRoute = inRoute;
+}
+
+void commitJournal(Solver & solver){
+    solver.journal.active = false;
+}
+
+void rollbackJournal(Solver & solver, vector < Technician > & solution){
+    MoveJournal & journal = solver.journal;
+    int route;
+    for(int i = 0; i < journal.numberSaved; i++){
+        route = journal.savedRouteIds[i];
+        //Locations of the rejected route may not be in the restored one
+        for(int pos = 1; pos < int(solution[route].route.size()) - 1; pos++){
+            solver.routeOf[solution[route].route[pos]] = -1;
+            solver.positionOf[solution[route].route[pos]] = -1;
+        }
+        swap(solution[route], journal.savedRoutes[i]);
+    }
+    for(int i = 0; i < journal.numberSaved; i++){
+        indexRoute(solver, solution, journal.savedRouteIds[i], 1);
+    }
+    Request * request;
+    for(int i = int(journal.flippedRequests.size()) - 1; i >= 0; i--){
+        request = &solver.requests[journal.flippedRequests[i]];
+        request->inRoute = journal.flippedValues[i];
+        markCustomer(solver, request->customer, request->inRoute);
+    }
+    journal.active = false;
+}
+
+bool readData(string path, ProblemInstance & instance) {
+    PROFILE_SCOPE(PROFILE_READ_DATA);
+    struct stat source;
+    if(stat(path.c_str(), &source) != 0){
+        return false;
+    }
+
+    string cachePath = path + ".bin";
+    if(loadBinaryInstance(cachePath, source, instance)){
+        prepareInstance(instance, true);
+        return true;
+    }
+    if(!readTextData(path, instance)){
+        return false;
+    }
+    prepareInstance(instance, false);
+    //Cache is best effort: a read only directory just means no cache
+    writeBinaryInstance(cachePath, source, instance);
+    return true;
+}
+
+void prepareInstance(ProblemInstance & instance, bool hasNeighborLists){
+    buildCustomerIndex(instance);
+    if(hasNeighborLists){
+        buildNeighborMask(instance);
+    }else{
+        buildNeighborLists(instance, NEIGHBOR_COUNT);
+    }
+    buildTransposes(instance.matrix);
+    buildKernelArrays(instance);
+}
+
+void buildTransposes(TravelMatrix & matrix){
+    const int TILE = 32;
+    int size = matrix.size;
+    const int * from[2] = {matrix.time.data(), matrix.cost.data()};
+    matrix.timeToward.resize(size * size);
+    matrix.costToward.resize(size * size);
+    int * to[2] = {matrix.timeToward.data(), matrix.costToward.data()};
+
+    //One matrix at a time, so a tile of both source and destination stays in L1
+    for(int m = 0; m < 2; m++){
+        for(int src0 = 0; src0 < size; src0 += TILE){
+            for(int dst0 = 0; dst0 < size; dst0 += TILE){
+                int srcEnd = minOf(src0 + TILE, size);
+                int dstEnd = minOf(dst0 + TILE, size);
+                for(int src = src0; src < srcEnd; src++){
+                    for(int dst = dst0; dst < dstEnd; dst++){
+                        to[m][dst * size + src] = from[m][src * size + dst];
+                    }
+                }
+            }
+        }
+    }
+}
+
+void buildKernelArrays(ProblemInstance & instance){
+    RequestArrays & arrays = instance.requestArrays;
+    int size = instance.matrix.size;
+
+    arrays.open.resize(size);
+    arrays.close.resize(size);
+    arrays.demand.resize(size);
+    for(int i = 0; i < size; i++){
+        arrays.open[i] = instance.requests[i].timeWindow.open;
+        arrays.close[i] = instance.requests[i].timeWindow.close;
+        arrays.demand[i] = instance.requests[i].demand;
+    }
+}
+
+void buildCustomerIndex(ProblemInstance & instance){
+    vector < Request > & requests = instance.requests;
+    instance.customerFirst.clear();
+    for(int i = 0; i < requests.size(); i++){
+        if(i == 0 || requests[i].customer_id != requests[i - 1].customer_id){
+            instance.customerFirst.push_back(i);
+        }
+        requests[i].customer = int(instance.customerFirst.size()) - 1;
+    }
+    instance.customerFirst.push_back(requests.size());
+}
+
+int temporalDistance(const ProblemInstance & instance, int src, int dst){
+    const TimeWindow & from = instance.requests[src].timeWindow;
+    const TimeWindow & to = instance.requests[dst].timeWindow;
+    int time = travelTime(instance.matrix, src, dst);
+
+    //Travel, wait even when leaving src as late as possible, heavy penalty when dst is always missed
+    int wait = maxOf(0, to.open - (from.close + time));
+    int late = maxOf(0, from.open + time - to.close);
+    return time + wait + 10 * late;
+}
+
+void buildNeighborLists(ProblemInstance & instance, int k){
+    const vector < Request > & requests = instance.requests;
+    NeighborLists & neighbors = instance.neighbors;
+    int size = requests.size();
+    int last = size - 1;
+    vector < pair < int, int > > spatial, temporal;
+
+    //Depots and other time windows of the same customer are never neighbors
+    neighbors.k = 0;
+    for(int r = 1; r < last; r++){
+        neighbors.k = maxOf(neighbors.k, last - 1 - (instance.customerFirst[requests[r].customer + 1] - instance.customerFirst[requests[r].customer]));
+    }
+    neighbors.k = minOf(k, neighbors.k);
+    neighbors.nearest.assign(size * neighbors.k, -1);
+    neighbors.compatible.assign(size * neighbors.k, -1);
+
+    for(int r = 1; r < last; r++){
+        spatial.clear();
+        temporal.clear();
+        for(int l = 1; l < last; l++){
+            if(requests[l].customer == requests[r].customer){
+                continue;
+            }
+            spatial.push_back(make_pair(travelTime(instance.matrix, r, l) + travelTime(instance.matrix, l, r), l));
+            temporal.push_back(make_pair(minOf(temporalDistance(instance, r, l), temporalDistance(instance, l, r)), l));
+        }
+        int count = minOf(neighbors.k, spatial.size());
+        partial_sort(spatial.begin(), spatial.begin() + count, spatial.end());
+        partial_sort(temporal.begin(), temporal.begin() + count, temporal.end());
+        for(int i = 0; i < count; i++){
+            neighbors.nearest[r * neighbors.k + i] = spatial[i].second;
+            neighbors.compatible[r * neighbors.k + i] = temporal[i].second;
+        }
+    }
+    buildNeighborMask(instance);
+}
+
+void buildNeighborMask(ProblemInstance & instance){
+    NeighborLists & neighbors = instance.neighbors;
+    int size = instance.requests.size();
+    int l;
+
+    neighbors.allowed.assign(size * size, false);
+    for(int r = 0; r < size; r++){
+        for(int i = 0; i < neighbors.k; i++){
+            l = neighbors.nearest[r * neighbors.k + i];
+            if(l != -1){
+                neighbors.allowed[r * size + l] = true;
+                neighbors.allowed[l * size + r] = true;
+            }
+            l = neighbors.compatible[r * neighbors.k + i];
+            if(l != -1){
+                neighbors.allowed[r * size + l] = true;
+                neighbors.allowed[l * size + r] = true;
+            }
+        }
+    }
+}
+
+bool readTextData(string path, ProblemInstance & instance) {
+    //open file to read
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0){
+        return false;
+    }
+    struct stat info;
+    if(fstat(fd, &info) != 0 || info.st_size == 0){
+        close(fd);
+        return false;
+    }
+    void * data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(data == MAP_FAILED){
+        return false;
+    }
+    madvise(data, info.st_size, MADV_SEQUENTIAL);
+
+    TextScanner scanner;
+    scanner.pos = static_cast<const char *>(data);
+    scanner.end = scanner.pos + info.st_size;
+    bool success = parseInstance(scanner, instance);
+
+    munmap(data, info.st_size);
+    return success;
+}
+
+uint64_t fnv1a(const char * data, size_t size){
+    uint64_t hash = 14695981039346656037ULL;
+    uint64_t word;
+    size_t i = 0;
+
+    //One step per 8-byte word, then the remaining bytes
+    for(; i + sizeof(word) <= size; i += sizeof(word)){
+        memcpy(&word, data + i, sizeof(word));
+        hash ^= word;
+        hash *= 1099511628211ULL;
+    }
+    for(; i < size; i++){
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+BinaryLayout binaryLayout(uint32_t number_requests, uint32_t string_bytes, uint32_t neighbor_k){
+    uint64_t arcs = uint64_t(number_requests) * number_requests;
+    BinaryLayout layout;
+    layout.requests = 0;
+    layout.coordinates = layout.requests + number_requests * sizeof(BinaryRequest);
+    layout.strings = layout.coordinates + number_requests * sizeof(Coordinate);
+    //Header is 128 bytes, so 64-byte aligned offsets are aligned in the mapped file
+    layout.time = (layout.strings + string_bytes + 63) / 64 * 64;
+    layout.cost = (layout.time + arcs * sizeof(int32_t) + 63) / 64 * 64;
+    layout.distance = (layout.cost + arcs * sizeof(int32_t) + 63) / 64 * 64;
+    layout.nearest = (layout.distance + arcs * sizeof(float) + 63) / 64 * 64;
+    layout.compatible = layout.nearest + uint64_t(number_requests) * neighbor_k * sizeof(int32_t);
+    layout.size = layout.compatible + uint64_t(number_requests) * neighbor_k * sizeof(int32_t);
+    return layout;
+}
+
+bool loadBinaryInstance(string cachePath, const struct stat & source, ProblemInstance & instance){
+    int fd = open(cachePath.c_str(), O_RDONLY);
+    if(fd < 0){
+        return false;
+    }
+    struct stat info;
+    if(fstat(fd, &info) != 0 || info.st_size < sizeof(BinaryHeader)){
+        close(fd);
+        return false;
+    }
+    void * data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(data == MAP_FAILED){
+        return false;
+    }
+
+    const char * bytes = static_cast<const char *>(data);
+    const BinaryHeader * header = reinterpret_cast<const BinaryHeader *>(bytes);
+    const char * payload = bytes + sizeof(BinaryHeader);
+    BinaryLayout layout = binaryLayout(header->number_requests, header->string_bytes, header->neighbor_k);
+
+    bool valid = memcmp(header->magic, BINARY_MAGIC, sizeof(BINARY_MAGIC)) == 0
+                 && header->version == BINARY_VERSION
+                 && header->source_size == uint64_t(source.st_size)
+                 && header->source_mtime == int64_t(source.st_mtim.tv_sec) * 1000000000 + source.st_mtim.tv_nsec
+                 && header->payload_size == layout.size
+                 && uint64_t(info.st_size) == sizeof(BinaryHeader) + layout.size
+                 && header->checksum == fnv1a(payload, layout.size);
+
+    if(valid){
+        Parameters & parameters = instance.parameters;
+        parameters.number_customers = header->number_customers;
+        parameters.number_locations = header->number_locations;
+        parameters.time_horizon = header->time_horizon;
+        parameters.vehicle_capacity = header->vehicle_capacity;
+        parameters.number_vehicle = parameters.number_customers;
+
+        int size = header->number_requests;
+        const BinaryRequest * table = reinterpret_cast<const BinaryRequest *>(payload + layout.requests);
+        const Coordinate * coordinates = reinterpret_cast<const Coordinate *>(payload + layout.coordinates);
+        const char * strings = payload + layout.strings;
+
+        vector < Request > & requests = instance.requests;
+        requests.resize(size);
+        for(int i = 0; i < size; i++){
+            requests[i].customer_id.assign(strings + table[i].customer_offset, table[i].customer_length);
+            requests[i].location_id.assign(strings + table[i].location_offset, table[i].location_length);
+            requests[i].location = i;
+            requests[i].coordinate = coordinates[i];
+            requests[i].demand = table[i].demand;
+            requests[i].inRoute = false;
+            requests[i].timeWindow.open = table[i].open;
+            requests[i].timeWindow.close = table[i].close;
+        }
+
+        TravelMatrix & matrix = instance.matrix;
+        const int32_t * time = reinterpret_cast<const int32_t *>(payload + layout.time);
+        const int32_t * cost = reinterpret_cast<const int32_t *>(payload + layout.cost);
+        const float * distance = reinterpret_cast<const float *>(payload + layout.distance);
+        matrix.size = size;
+        matrix.time.assign(time, time + size * size);
+        matrix.cost.assign(cost, cost + size * size);
+        matrix.distance.assign(distance, distance + size * size);
+
+        NeighborLists & neighbors = instance.neighbors;
+        const int32_t * nearest = reinterpret_cast<const int32_t *>(payload + layout.nearest);
+        const int32_t * compatible = reinterpret_cast<const int32_t *>(payload + layout.compatible);
+        neighbors.k = header->neighbor_k;
+        neighbors.nearest.assign(nearest, nearest + size * neighbors.k);
+        neighbors.compatible.assign(compatible, compatible + size * neighbors.k);
+    }
+
+    munmap(data, info.st_size);
+    return valid;
+}
+
+bool writeBinaryInstance(string cachePath, const struct stat & source, const ProblemInstance & instance){
+    const vector < Request > & requests = instance.requests;
+    const TravelMatrix & matrix = instance.matrix;
+    uint32_t size = requests.size();
+
+    vector < BinaryRequest > table(size);
+    vector < Coordinate > coordinates(size);
+    string strings;
+    for(uint32_t i = 0; i < size; i++){
+        table[i].customer_offset = strings.size();
+        table[i].customer_length = requests[i].customer_id.size();
+        strings += requests[i].customer_id;
+        table[i].location_offset = strings.size();
+        table[i].location_length = requests[i].location_id.size();
+        strings += requests[i].location_id;
+        table[i].demand = requests[i].demand;
+        table[i].open = requests[i].timeWindow.open;
+        table[i].close = requests[i].timeWindow.close;
+        coordinates[i] = requests[i].coordinate;
+    }
+
+    const NeighborLists & neighbors = instance.neighbors;
+    BinaryLayout layout = binaryLayout(size, strings.size(), neighbors.k);
+    vector < char > payload(layout.size, 0);
+    memcpy(payload.data() + layout.requests, table.data(), size * sizeof(BinaryRequest));
+    memcpy(payload.data() + layout.coordinates, coordinates.data(), size * sizeof(Coordinate));
+    memcpy(payload.data() + layout.strings, strings.data(), strings.size());
+    memcpy(payload.data() + layout.time, matrix.time.data(), size * size * sizeof(int32_t));
+    memcpy(payload.data() + layout.cost, matrix.cost.data(), size * size * sizeof(int32_t));
+    memcpy(payload.data() + layout.distance, matrix.distance.data(), size * size * sizeof(float));
+    memcpy(payload.data() + layout.nearest, neighbors.nearest.data(), size * neighbors.k * sizeof(int32_t));
+    memcpy(payload.data() + layout.compatible, neighbors.compatible.data(), size * neighbors.k * sizeof(int32_t));
+
+    BinaryHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, BINARY_MAGIC, sizeof(BINARY_MAGIC));
+    header.version = BINARY_VERSION;
+    header.number_requests = size;
+    header.source_size = source.st_size;
+    header.source_mtime = int64_t(source.st_mtim.tv_sec) * 1000000000 + source.st_mtim.tv_nsec;
+    header.payload_size = layout.size;
+    header.checksum = fnv1a(payload.data(), payload.size());
+    header.number_customers = instance.parameters.number_customers;
+    header.number_locations = instance.parameters.number_locations;
+    header.time_horizon = instance.parameters.time_horizon;
+    header.vehicle_capacity = instance.parameters.vehicle_capacity;
+    header.string_bytes = strings.size();
+    header.neighbor_k = neighbors.k;
+
+    //Write aside and rename, so a concurrent reader never maps a partial cache
+    string tempPath = cachePath + ".tmp" + to_string(getpid()) + "-" + to_string(hash < thread::id >()(this_thread::get_id()));
+    ofstream file(tempPath, ios::out | ios::binary | ios::trunc);
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(payload.data(), payload.size());
+    file.close();
+    if(!file || rename(tempPath.c_str(), cachePath.c_str()) != 0){
+        remove(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+void skipSpaces(TextScanner & scanner){
+    while(scanner.pos < scanner.end && (*scanner.pos == ' ' || *scanner.pos == '\t')){
+        scanner.pos++;
+    }
+}
+
+void skipWhitespace(TextScanner & scanner){
+    while(scanner.pos < scanner.end && isspace(static_cast<unsigned char>(*scanner.pos))){
+        scanner.pos++;
+    }
+}
+
+void skipLine(TextScanner & scanner){
+    while(scanner.pos < scanner.end && *scanner.pos != '\n'){
+        scanner.pos++;
+    }
+    if(scanner.pos < scanner.end){
+        scanner.pos++;
+    }
+}
+
+bool atLineEnd(TextScanner & scanner){
+    skipSpaces(scanner);
+    return scanner.pos >= scanner.end || *scanner.pos == '\n' || *scanner.pos == '\r';
+}
+
+bool expectChar(TextScanner & scanner, char c){
+    skipSpaces(scanner);
+    if(scanner.pos < scanner.end && *scanner.pos == c){
+        scanner.pos++;
+        return true;
+    }
+    return false;
+}
+
+bool scanInt(TextScanner & scanner, int & value){
+    skipSpaces(scanner);
+    from_chars_result result = from_chars(scanner.pos, scanner.end, value);
+    scanner.pos = result.ptr;
+    return result.ec == errc();
+}
+
+bool scanFloat(TextScanner & scanner, float & value){
+    skipSpaces(scanner);
+    from_chars_result result = from_chars(scanner.pos, scanner.end, value);
+    scanner.pos = result.ptr;
+    return result.ec == errc();
+}
+
+string_view scanToken(TextScanner & scanner){
+    skipSpaces(scanner);
+    const char * begin = scanner.pos;
+    while(scanner.pos < scanner.end && !isspace(static_cast<unsigned char>(*scanner.pos))
+          && *scanner.pos != '[' && *scanner.pos != ',' && *scanner.pos != '(' && *scanner.pos != ')'){
+        scanner.pos++;
+    }
+    return string_view(begin, scanner.pos - begin);
+}
+
+bool parseInstance(TextScanner & scanner, ProblemInstance & instance){
+    Parameters & parameters = instance.parameters;
+    vector < Request > & requests = instance.requests;
+    TravelMatrix & matrix = instance.matrix;
+    requests.clear();
+
+    /*
+     * Read genaral paramaters
+     */
+    skipLine(scanner);
+    skipWhitespace(scanner);
+    if(!scanInt(scanner, parameters.number_customers) || !scanInt(scanner, parameters.number_locations)
+       || !scanInt(scanner, parameters.time_horizon) || !scanInt(scanner, parameters.vehicle_capacity)){
+        return false;
+    }
+    parameters.number_vehicle = parameters.number_customers;
+
+    /*
+     * Read request: all parameter
+     */
+    //Read customer schedule: depot, customer 1->number of customer, end depot
+    skipWhitespace(scanner);
+    skipLine(scanner);
+    skipWhitespace(scanner);
+
+    Request one_location;
+    one_location.inRoute = false;
+    one_location.coordinate.x = 0;
+    one_location.coordinate.y = 0;
+
+    string_view customer_id;
+    for(int i = 0; i <= parameters.number_customers + 1; i++){
+        customer_id = scanToken(scanner);
+        if(customer_id.empty() || !scanInt(scanner, one_location.demand)){
+            return false;
+        }
+        one_location.customer_id = string(customer_id);
+
+        //One location per time window until end of line
+        while(!atLineEnd(scanner)){
+            one_location.location_id = string(scanToken(scanner));
+            if(!expectChar(scanner, '[') || !scanInt(scanner, one_location.timeWindow.open) || !expectChar(scanner, ',')
+               || !scanInt(scanner, one_location.timeWindow.close) || !expectChar(scanner, ']')){
+                return false;
+            }
+            requests.push_back(one_location);
+        }
+        skipWhitespace(scanner);
+    }
+
+    //Intern location ids to contiguous index of matrix
+    unordered_map < string_view, int > locationIndex;
+    for(int i = 0; i < requests.size(); i++){
+        requests[i].location = i;
+        locationIndex[requests[i].location_id] = i;
+    }
+
+    //Read location coordinate
+    skipLine(scanner);
+    skipWhitespace(scanner);
+
+    unordered_map < string_view, int >::iterator found;
+    Coordinate coordinate;
+    for(int i = 0; i < parameters.number_locations; i++){
+        found = locationIndex.find(scanToken(scanner));
+        if(!scanFloat(scanner, coordinate.x) || !scanFloat(scanner, coordinate.y)){
+            return false;
+        }
+        if(found != locationIndex.end()){
+            requests[found->second].coordinate = coordinate;
+        }
+        skipWhitespace(scanner);
+    }
+
+    int size = int(requests.size());
+    matrix.size = size;
+    matrix.time.assign(size * size, 0);
+    matrix.cost.assign(size * size, 0);
+    matrix.distance.assign(size * size, 0);
+
+    //Read Travel time matrix to instance.matrix: (src, dst) time cost
+    skipLine(scanner);
+    skipWhitespace(scanner);
+
+    unordered_map < string_view, int >::iterator src;
+    unordered_map < string_view, int >::iterator dst;
+    int time;
+    int cost;
+    int arc;
+    while(scanner.pos < scanner.end){
+        if(!expectChar(scanner, '(')){
+            return false;
+        }
+        src = locationIndex.find(scanToken(scanner));
+        expectChar(scanner, ',');
+        dst = locationIndex.find(scanToken(scanner));
+        if(!expectChar(scanner, ')') || !scanInt(scanner, time) || !scanInt(scanner, cost)){
+            return false;
+        }
+        if(src != locationIndex.end() && dst != locationIndex.end()){
+            arc = src->second * size + dst->second;
+            matrix.time[arc] = time;
+            matrix.cost[arc] = cost;
+        }
+        skipWhitespace(scanner);
+    }
+
+    //Calcualte distance
+    for(int i = 0; i < size; i++){
+        for(int j = 0; j < size; j++){
+            matrix.distance[i * size + j] = calculateDistance(requests[i].coordinate, requests[j].coordinate);
+        }
+    }
+    return true;
+}
+
+GeneratorOptions defaultGeneratorOptions(){
+    GeneratorOptions options;
+    options.number_customers = 100;
+    options.windows_per_customer = 4;
+    options.time_horizon = 720;
+    options.tightness = 0.3;
+    options.demand_min = 20;
+    options.demand_max = 80;
+    options.vehicle_capacity = 750;
+    return options;
+}
+
+void generateInstance(ProblemInstance & instance, const GeneratorOptions & options, unsigned seed){
+    Parameters & parameters = instance.parameters;
+    vector < Request > & requests = instance.requests;
+    TravelMatrix & matrix = instance.matrix;
+    mt19937 rng(seed);
+    int horizon = options.time_horizon;
+    //Every customer fits a vehicle on its own
+    int demand_max = minOf(options.demand_max, options.vehicle_capacity);
+    int demand_min = minOf(options.demand_min, demand_max);
+    float radius = horizon / 8.0;
+
+    parameters.number_customers = options.number_customers;
+    parameters.time_horizon = horizon;
+    parameters.vehicle_capacity = options.vehicle_capacity;
+    parameters.number_vehicle = options.number_customers;
+    requests.clear();
+
+    Request one_location;
+    one_location.inRoute = false;
+    one_location.coordinate.x = 0;
+    one_location.coordinate.y = 0;
+    one_location.demand = 0;
+    one_location.timeWindow.open = 0;
+    one_location.timeWindow.close = horizon;
+
+    //Depot, customers 1 -> number_customers, end depot: customer id c, location ids in order
+    one_location.customer_id = "0";
+    one_location.location_id = "0";
+    requests.push_back(one_location);
+    for(int c = 1; c <= options.number_customers; c++){
+        //Uniform in the disc: one way trip at most horizon / 4
+        float angle = 2 * M_PI * randomUnit(rng);
+        float length = radius * sqrt(randomUnit(rng));
+        one_location.customer_id = to_string(c);
+        one_location.coordinate.x = length * cos(angle);
+        one_location.coordinate.y = length * sin(angle);
+        one_location.demand = demand_min + randomInt(rng, maxOf(1, demand_max - demand_min + 1));
+
+        //Windows in equal slots of [arrive, leave], where the depot is reached back before the horizon
+        int trip = int(ceil(2 * calculateDistance(requests[0].coordinate, one_location.coordinate)));
+        int arrive = trip;
+        int leave = horizon - trip - 1;
+        int number_window = 1 + randomInt(rng, maxOf(1, options.windows_per_customer));
+        int slot = maxOf(1, (leave - arrive) / number_window);
+        int width = maxOf(1, int(slot * options.tightness));
+        for(int w = 0; w < number_window; w++){
+            one_location.location_id = to_string(requests.size());
+            one_location.timeWindow.open = arrive + w * slot + randomInt(rng, maxOf(1, slot - width));
+            one_location.timeWindow.close = minOf(leave, one_location.timeWindow.open + width);
+            requests.push_back(one_location);
+        }
+    }
+    one_location.customer_id = to_string(options.number_customers + 1);
+    one_location.location_id = to_string(requests.size());
+    one_location.coordinate.x = 0;
+    one_location.coordinate.y = 0;
+    one_location.demand = 0;
+    one_location.timeWindow.open = 0;
+    one_location.timeWindow.close = horizon;
+    requests.push_back(one_location);
+
+    int size = int(requests.size());
+    parameters.number_locations = size;
+    matrix.size = size;
+    matrix.time.assign(size * size, 0);
+    matrix.cost.assign(size * size, 0);
+    matrix.distance.assign(size * size, 0);
+    for(int i = 0; i < size; i++){
+        requests[i].location = i;
+        for(int j = 0; j < size; j++){
+            float distance = calculateDistance(requests[i].coordinate, requests[j].coordinate);
+            matrix.distance[i * size + j] = distance;
+            //Rounded up: the sum of two rounded legs never falls below the direct arc
+            matrix.time[i * size + j] = int(ceil(2 * distance));
+            matrix.cost[i * size + j] = int(ceil(distance));
+        }
+    }
+    prepareInstance(instance, false);
+}
+
+void appendInt(string & text, int value){
+    char digits[16];
+    to_chars_result written = to_chars(digits, digits + sizeof(digits), value);
+    text.append(digits, written.ptr);
+}
+
+void appendFloat(string & text, float value){
+    char digits[32];
+    to_chars_result written = to_chars(digits, digits + sizeof(digits), value);
+    text.append(digits, written.ptr);
+}
+
+bool writeInstance(string path, const ProblemInstance & instance){
+    const Parameters & parameters = instance.parameters;
+    const vector < Request > & requests = instance.requests;
+    const TravelMatrix & matrix = instance.matrix;
+    int size = requests.size();
+    ofstream file(path, ios::out | ios::binary | ios::trunc);
+    if(!file){
+        return false;
+    }
+
+    //Sections as in the shipped instances, text flushed in blocks of about 1 MB
+    string text = "General parameters \n\n";
+    appendInt(text, parameters.number_customers);
+    text += ' ';
+    appendInt(text, size);
+    text += ' ';
+    appendInt(text, parameters.time_horizon);
+    text += ' ';
+    appendInt(text, parameters.vehicle_capacity);
+    text += "\n\n\nCustomer schedules \n\n";
+    for(int i = 0; i < size; i++){
+        if(i == 0 || requests[i].customer_id != requests[i - 1].customer_id){
+            if(i > 0){
+                text += '\n';
+            }
+            text += requests[i].customer_id;
+            text += ' ';
+            appendInt(text, requests[i].demand);
+            text += '\t';
+        }
+        text += requests[i].location_id;
+        text += " [";
+        appendInt(text, requests[i].timeWindow.open);
+        text += ',';
+        appendInt(text, requests[i].timeWindow.close);
+        text += "]\t";
+    }
+    text += "\n\n\nLocation coordinates\n\n";
+    for(int i = 0; i < size; i++){
+        text += requests[i].location_id;
+        text += ' ';
+        appendFloat(text, requests[i].coordinate.x);
+        text += ' ';
+        appendFloat(text, requests[i].coordinate.y);
+        text += '\n';
+    }
+    text += "\n\nTravel time matrix \n\n";
+    for(int src = 0; src < size; src++){
+        for(int dst = 0; dst < size; dst++){
+            text += '(';
+            text += requests[src].location_id;
+            text += ", ";
+            text += requests[dst].location_id;
+            text += ") ";
+            appendInt(text, travelTime(matrix, src, dst));
+            text += ' ';
+            appendInt(text, travelCost(matrix, src, dst));
+            text += '\n';
+        }
+        if(text.size() > (1 << 20)){
+            file.write(text.data(), text.size());
+            text.clear();
         }
     }
+    file.write(text.data(), text.size());
+    file.close();
+    return bool(file);
 }
 
 void updateAfter(Technician & _tech, int pos){
+    PROFILE_SCOPE(PROFILE_UPDATE_AFTER);
     int waitOlder;
 
     for(int i = pos + 1; i < _tech.route.size(); i++){
@@ -468,233 +2458,441 @@ void updateAfter(Technician & _tech, int pos){
     }
 }
 
-void updateBefore(Technician & _tech, int pos){
-    for(int i = pos; i > 0; i--){
-        _tech.maxShift[i] = calculateMaxShift(_tech.route[i], _tech, i);
+void updateBefore(const ProblemInstance & instance, Technician & _tech, int pos){
+    PROFILE_SCOPE(PROFILE_UPDATE_BEFORE);
+    for(int i = pos; i >= 0; i--){
+        _tech.maxShift[i] = calculateMaxShift(instance.requests[_tech.route[i]], _tech, i);
     }
 }
 
-void scoreInsertion(vector<Technician> & solution, vector < Request > & requests, Parameters parameters){
-    BestPair bestPair;
-    int shift;
+float insertionRatio(InsertionRule rule, const InsertionCandidate & candidate){
+    switch(rule){
+        case FIRST_RULE:
+            return -calculateRatio(candidate.shift, candidate.cost);
+        case SCORE_RULE:
+            return calculateRatio(candidate.shift, candidate.cost);
+        case GREEDY_RULE:
+            return calculateRatio(1, candidate.costDelta);
+        default:
+            return -candidate.costDelta;
+    }
+}
+
+void evaluateRouteInsertions(Solver & solver, InsertionCache & cache, int route, vector < Technician > & solution){
+    vector < Request > & requests = solver.requests;
+    KernelScratch & scratch = solver.scratch;
+    Technician & _tech = solution[route];
+    int capacity = solver.instance->parameters.vehicle_capacity;
+    int number = requests.size();
+
+    scratch.active.resize(number);
+    scratch.ratio.resize(number);
+    scratch.position.resize(number);
+    scratch.shift.resize(number);
+    for(int i = 0; i < number; i++){
+        scratch.active[i] = (!requests[i].inRoute && requests[i].demand + _tech.usedSize <= capacity) ? -1 : 0;
+        scratch.ratio[i] = cache.noRatio;
+        scratch.position[i] = 0;
+        scratch.shift[i] = 0;
+        PROFILE_COUNT(PROFILE_INSERTION_PROBES, -scratch.active[i] * int64_t(_tech.route.size() - 1));
+    }
+
+    scoreInsertions(*solver.instance, _tech, cache.rule, cache.granular, scratch, number);
+
+    for(int i = 0; i < number; i++){
+        BestPair & entry = cache.entries[i * cache.numberRoutes + route];
+        entry.highestRatio = scratch.ratio[i];
+        entry.routeId = route;
+        entry.indexOfRequest = i;
+        entry.position = scratch.position[i];
+        entry.shift = scratch.shift[i];
+    }
+}
+
+void scoreInsertions(const ProblemInstance & instance, const Technician & _tech, InsertionRule rule, bool granular, KernelScratch & scratch, int number){
+#ifdef __x86_64__
+    static const bool hasAvx2 = __builtin_cpu_supports("avx2");
+    if(hasAvx2){
+        scoreInsertionsAvx2(instance, _tech, rule, granular, scratch, number);
+        return;
+    }
+#endif
+    scoreInsertionsScalar(instance, _tech, rule, granular, scratch, 0, number);
+}
+
+void scoreInsertionsScalar(const ProblemInstance & instance, const Technician & _tech, InsertionRule rule, bool granular, KernelScratch & scratch, int begin, int end){
+    const vector < char > & allowed = instance.neighbors.allowed;
+    int size = instance.matrix.size;
+    InsertionCandidate candidate;
     float ratio;
-    bool hasChange = true;
 
-    while (!checkAllRequest(requests)) {
-        if (!hasChange) {
-            cout << "\t- Need more vehicle\n";
-            break;
+    for(int pos = 1; pos < _tech.route.size(); pos++){
+        int prev = _tech.route[pos - 1];
+        int next = _tech.route[pos];
+        //Granular: skip arcs with no neighbor of the request, next to a depot is always tried
+        bool everywhere = !granular || pos == 1 || pos == _tech.route.size() - 1;
+        for(int i = begin; i < end; i++){
+            if(!scratch.active[i] || (!everywhere && !allowed[prev * size + i] && !allowed[next * size + i])){
+                continue;
+            }
+            candidate = evaluateInsertion(instance, instance.requests[i], _tech, pos);
+            if(candidate.feasible){
+                ratio = insertionRatio(rule, candidate);
+                if(ratio > scratch.ratio[i]){
+                    scratch.ratio[i] = ratio;
+                    scratch.position[i] = pos;
+                    scratch.shift[i] = candidate.shift;
+                }
+            }
         }
-        bestPair.highestRatio = -1;
-        bestPair.position = 0;
-        bestPair.routeId = 0;
-        bestPair.indexOfRequest = 0;
-        bestPair.shift = 0;
-        //Loop for all vehicle
-        for (int route = 0; route < solution.size(); route++) {
-            //Loop for all position in route
-            for (int pos = 1; pos < solution[route].route.size(); pos++) {
-                //Loop for all request
-                for (int i = 0; i < requests.size(); i++) {
-                    if (!requests[i].inRoute &&
-                            requests[i].demand + solution[route].usedSize <= parameters.vehicle_capacity &&
-                            requests[i].timeWindow.close > solution[route].startTime[pos - 1] +
-                                                      travelTimeMatrix[solution[route].route[pos -
-                                                                                             1].location_id][requests[i].location_id].time) {
-                        shift = calculateShift(requests[i], solution[route], pos);
-                        if (shift <= solution[route].waitTime[pos] + solution[route].maxShift[pos]) {
-                            ratio = calculateRatio(shift, travelTimeMatrix[solution[route].route[pos -
-                                                                                                 1].location_id][requests[i].location_id].cost +
-                                                          travelTimeMatrix[requests[i].location_id][solution[route].route[pos].location_id].cost);
-                            if (ratio > bestPair.highestRatio) {
-                                bestPair.highestRatio = ratio;
-                                bestPair.indexOfRequest = i;
-                                bestPair.routeId = route;
-                                bestPair.position = pos;
-                                bestPair.shift = shift;
-                            }
-                        }
+    }
+}
 
-                    }
-                }
+#ifdef __x86_64__
+__attribute__((target("avx2")))
+void scoreInsertionsAvx2(const ProblemInstance & instance, const Technician & _tech, InsertionRule rule, bool granular, KernelScratch & scratch, int number){
+    const TravelMatrix & matrix = instance.matrix;
+    const RequestArrays & arrays = instance.requestArrays;
+    const char * allowed = instance.neighbors.allowed.data();
+    int size = matrix.size;
+    int blocks = number - number % 8;
+
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256 hundred = _mm256_set1_ps(100.0f);
+    const __m256 sign = _mm256_set1_ps(-0.0f);
+    __m256i feasible, timeFrom, arriving, wait, shift, cost;
+    __m256 value, best, better;
+
+    for(int pos = 1; pos < _tech.route.size(); pos++){
+        int prev = _tech.route[pos - 1];
+        int next = _tech.route[pos];
+        bool everywhere = !granular || pos == 1 || pos == _tech.route.size() - 1;
+        const __m256i start = _mm256_set1_epi32(_tech.startTime[pos - 1]);
+        const __m256i direct = _mm256_set1_epi32(travelTime(matrix, prev, next));
+        const __m256i directCost = _mm256_set1_epi32(travelCost(matrix, prev, next));
+        const __m256i slack = _mm256_set1_epi32(_tech.waitTime[pos] + _tech.maxShift[pos]);
+        const __m256i position = _mm256_set1_epi32(pos);
+        const int * timeFromPrev = &matrix.time[prev * size];
+        const int * timeToNext = &matrix.timeToward[next * size];
+        const int * costFromPrev = &matrix.cost[prev * size];
+        const int * costToNext = &matrix.costToward[next * size];
+
+        for(int i = 0; i < blocks; i += 8){
+            feasible = _mm256_load_si256((const __m256i *)&scratch.active[i]);
+            if(!everywhere){
+                //allowed is symmetric, so row prev holds allowed[request][prev] of 8 requests
+                __m128i near = _mm_or_si128(_mm_loadl_epi64((const __m128i *)(allowed + prev * size + i)),
+                                            _mm_loadl_epi64((const __m128i *)(allowed + next * size + i)));
+                feasible = _mm256_andnot_si256(_mm256_cmpeq_epi32(_mm256_cvtepu8_epi32(near), zero), feasible);
+            }
+            if(_mm256_testz_si256(feasible, feasible)){
+                continue;
+            }
+
+            //Same steps as evaluateInsertion
+            timeFrom = _mm256_loadu_si256((const __m256i *)(timeFromPrev + i));
+            arriving = _mm256_add_epi32(start, timeFrom);
+            feasible = _mm256_and_si256(feasible, _mm256_cmpgt_epi32(_mm256_load_si256((const __m256i *)&arrays.close[i]), arriving));
+            wait = _mm256_max_epi32(zero, _mm256_sub_epi32(_mm256_load_si256((const __m256i *)&arrays.open[i]), arriving));
+            shift = _mm256_sub_epi32(_mm256_add_epi32(_mm256_add_epi32(timeFrom, wait),
+                                                      _mm256_loadu_si256((const __m256i *)(timeToNext + i))), direct);
+            feasible = _mm256_andnot_si256(_mm256_cmpgt_epi32(shift, slack), feasible);
+            if(_mm256_testz_si256(feasible, feasible)){
+                continue;
             }
+            cost = _mm256_add_epi32(_mm256_loadu_si256((const __m256i *)(costFromPrev + i)),
+                                    _mm256_loadu_si256((const __m256i *)(costToNext + i)));
+
+            //Same as insertionRatio: float product, float division of 100 matches the scalar double one
+            switch(rule){
+                case FIRST_RULE:
+                    value = _mm256_xor_ps(sign, _mm256_div_ps(hundred, _mm256_mul_ps(_mm256_cvtepi32_ps(shift), _mm256_cvtepi32_ps(cost))));
+                    break;
+                case SCORE_RULE:
+                    value = _mm256_div_ps(hundred, _mm256_mul_ps(_mm256_cvtepi32_ps(shift), _mm256_cvtepi32_ps(cost)));
+                    break;
+                case GREEDY_RULE:
+                    value = _mm256_div_ps(hundred, _mm256_cvtepi32_ps(_mm256_sub_epi32(cost, directCost)));
+                    break;
+                default:
+                    value = _mm256_cvtepi32_ps(_mm256_sub_epi32(directCost, cost));
+                    break;
+            }
+
+            best = _mm256_load_ps(&scratch.ratio[i]);
+            better = _mm256_and_ps(_mm256_cmp_ps(value, best, _CMP_GT_OQ), _mm256_castsi256_ps(feasible));
+            _mm256_store_ps(&scratch.ratio[i], _mm256_blendv_ps(best, value, better));
+            _mm256_store_si256((__m256i *)&scratch.position[i], _mm256_castps_si256(_mm256_blendv_ps(
+                _mm256_load_ps((const float *)&scratch.position[i]), _mm256_castsi256_ps(position), better)));
+            _mm256_store_si256((__m256i *)&scratch.shift[i], _mm256_castps_si256(_mm256_blendv_ps(
+                _mm256_load_ps((const float *)&scratch.shift[i]), _mm256_castsi256_ps(shift), better)));
         }
+    }
 
-        if (bestPair.highestRatio != -1) {
-            //Insert request has best pair to solution
-            insertToRoute(requests[bestPair.indexOfRequest], bestPair.position, solution[bestPair.routeId],
-                          bestPair.shift, requests);
+    //Clear upper halves before going back to SSE code, the compiler does not do it for a target function
+    _mm256_zeroupper();
 
-            //Update value for after insert request
-            updateAfter(solution[bestPair.routeId], bestPair.position);
+    //Last number % 8 requests
+    scoreInsertionsScalar(instance, _tech, rule, granular, scratch, blocks, number);
+}
+#endif
+
+void initInsertionCache(Solver & solver, InsertionCache & cache, InsertionRule rule, vector < Technician > & solution){
+    vector < Request > & requests = solver.requests;
+    cache.rule = rule;
+    cache.granular = solver.config.granular;
+    cache.noRatio = (rule == FIRST_RULE || rule == REGRET_RULE) ? -100000000 : -1;
+    cache.numberRoutes = solution.size();
+    cache.entries.resize(requests.size() * solution.size());
+    cache.emptyRoute.assign(solution.size(), false);
+
+    //Empty routes only hold the depots, so they all share the same candidates
+    int emptyRoute = -1;
+    for(int route = 0; route < solution.size(); route++){
+        cache.emptyRoute[route] = solution[route].route.size() == 2 && solution[route].usedSize == 0;
+        if(cache.emptyRoute[route] && emptyRoute != -1){
+            for(int i = 0; i < requests.size(); i++){
+                cache.entries[i * cache.numberRoutes + route] = cache.entries[i * cache.numberRoutes + emptyRoute];
+                cache.entries[i * cache.numberRoutes + route].routeId = route;
+            }
+            continue;
+        }
+        evaluateRouteInsertions(solver, cache, route, solution);
+        if(cache.emptyRoute[route]){
+            emptyRoute = route;
+        }
+    }
 
-            //Update maxshift for before insert's request
-            updateBefore(solution[bestPair.routeId], bestPair.position);
-        } else {
-            hasChange = false;
+    cache.bestOfRequest.resize(requests.size());
+    for(int i = 0; i < requests.size(); i++){
+        cache.bestOfRequest[i].highestRatio = cache.noRatio;
+        for(int route = 0; route < cache.numberRoutes; route++){
+            if(cache.entries[i * cache.numberRoutes + route].highestRatio > cache.bestOfRequest[i].highestRatio){
+                cache.bestOfRequest[i] = cache.entries[i * cache.numberRoutes + route];
+            }
         }
-        //displayRoute();
     }
 }
 
-void firstInsertion(vector < Technician > & solution, vector < Request > & requests, Parameters parameters){
-    BestPair bestPair;
-    int shift;
-    float ratio;
-    bool hasChange = true;
+void refreshInsertionCache(Solver & solver, InsertionCache & cache, int route, vector < Technician > & solution){
+    vector < Request > & requests = solver.requests;
+    evaluateRouteInsertions(solver, cache, route, solution);
 
-    while(!checkAllRequest(requests)){
-        if(!hasChange){
-            cout << "\t- Need more vehicle\n";
-            break;
+    for(int i = 0; i < requests.size(); i++){
+        if(requests[i].inRoute){
+            continue;
+        }
+        BestPair & best = cache.bestOfRequest[i];
+        BestPair & entry = cache.entries[i * cache.numberRoutes + route];
+        if(entry.highestRatio > best.highestRatio){
+            best = entry;
+        }else if(best.routeId == route){
+            //Best candidate of request was in the changed route: rescan its row
+            best.highestRatio = cache.noRatio;
+            for(int r = 0; r < cache.numberRoutes; r++){
+                if(cache.entries[i * cache.numberRoutes + r].highestRatio > best.highestRatio){
+                    best = cache.entries[i * cache.numberRoutes + r];
+                }
+            }
         }
-        bestPair.highestRatio = 100000000;
+    }
+}
+
+void bestInsertion(Solver & solver, vector < Technician > & solution, InsertionRule rule){
+    vector < Request > & requests = solver.requests;
+    InsertionCache & cache = solver.insertionCache;
+    BestPair bestPair;
+
+    initInsertionCache(solver, cache, rule, solution);
+
+    while(!checkAllRequest(solver)){
+        bestPair.highestRatio = cache.noRatio;
         bestPair.position = 0;
         bestPair.routeId = 0;
         bestPair.indexOfRequest = 0;
         bestPair.shift = 0;
-        //Loop for all vehicle
-        for(int route = 0; route < solution.size(); route++){
-            //Loop for all position in route
-            for(int pos = 1; pos < solution[route].route.size(); pos++){
-                //Loop for all request
-                for(int i = 0; i < requests.size(); i++){
-                    if(!requests[i].inRoute &&
-                            requests[i].demand + solution[route].usedSize <= parameters.vehicle_capacity &&
-                            requests[i].timeWindow.close > solution[route].startTime[pos-1] + travelTimeMatrix[solution[route].route[pos-1].location_id][requests[i].location_id].time)
-                    {
-                        shift = calculateShift(requests[i], solution[route], pos);
-                        if(shift <= solution[route].waitTime[pos] + solution[route].maxShift[pos]){
-                            ratio = calculateRatio(shift, travelTimeMatrix[solution[route].route[pos-1].location_id][requests[i].location_id].cost + travelTimeMatrix[requests[i].location_id][solution[route].route[pos].location_id].cost);
-                            if(ratio < bestPair.highestRatio){
-                                bestPair.highestRatio = ratio;
-                                bestPair.indexOfRequest = i;
-                                bestPair.routeId = route;
-                                bestPair.position = pos;
-                                bestPair.shift = shift;
-                            }
-                        }
-
-                    }
-                }
+        for(int i = 0; i < requests.size(); i++){
+            if(!requests[i].inRoute && cache.bestOfRequest[i].highestRatio > bestPair.highestRatio){
+                bestPair = cache.bestOfRequest[i];
             }
         }
 
-        if(bestPair.highestRatio != 100000000) {
-            //Insert request has best pair to solution
-            insertToRoute(requests[bestPair.indexOfRequest], bestPair.position, solution[bestPair.routeId], bestPair.shift, requests);
+        if(bestPair.highestRatio == cache.noRatio){
+            cout << "\t- Need more vehicle\n";
+            break;
+        }
 
-            //Update value for after insert request
-            updateAfter(solution[bestPair.routeId], bestPair.position);
+        applyInsertion(solver, solution, bestPair);
 
-            //Update maxshift for before insert's request
-            updateBefore(solution[bestPair.routeId], bestPair.position);
-        }else{
-            hasChange = false;
-        }
-        //displayRoute();
+        //Only candidates into the changed route are stale
+        refreshInsertionCache(solver, cache, bestPair.routeId, solution);
     }
-    return;
 }
 
-void greedyBasicInsertion(vector<Technician> & solution, vector < Request > & requests, Parameters parameters){
+void applyInsertion(Solver & solver, vector < Technician > & solution, const BestPair & bestPair){
+    //Insert request has best pair to solution
+    touchRoute(solver, solution, bestPair.routeId);
+    insertToRoute(solver, solver.requests[bestPair.indexOfRequest], bestPair.position, solution, bestPair.routeId, bestPair.shift);
+
+    //Update value for after insert request
+    updateAfter(solution[bestPair.routeId], bestPair.position);
+
+    //Update maxshift for before insert's request
+    updateBefore(*solver.instance, solution[bestPair.routeId], bestPair.position);
+}
+
+void regretInsertion(Solver & solver, vector < Technician > & solution, int k){
+    PROFILE_SCOPE(k == 2 ? PROFILE_REGRET2_INSERTION : PROFILE_REGRET3_INSERTION);
+    vector < Request > & requests = solver.requests;
+    InsertionCache & cache = solver.insertionCache;
     BestPair bestPair;
-    int shift;
-    float ratio;
-    bool hasChange = true;
+    float regret, highestRegret;
+    int request;
 
-    while (!checkAllRequest(requests)) {
-        if (!hasChange) {
-            cout << "\t- Need more vehicle\n";
-            break;
+    initInsertionCache(solver, cache, REGRET_RULE, solution);
+    cache.k = k;
+    cache.topRoutes.assign(requests.size() * k, -1);
+    for(int i = 0; i < requests.size(); i++){
+        if(!requests[i].inRoute){
+            rankRegretRoutes(cache, i);
         }
-        bestPair.highestRatio = -1;
-        bestPair.position = 0;
-        bestPair.routeId = 0;
-        bestPair.indexOfRequest = 0;
-        bestPair.shift = 0;
-        //Loop for all vehicle
-        for (int route = 0; route < solution.size(); route++) {
-            //Loop for all position in route
-            for (int pos = 1; pos < solution[route].route.size(); pos++) {
-                //Loop for all request
-                for (int i = 0; i < requests.size(); i++) {
-                    if (!requests[i].inRoute &&
-                            requests[i].demand + solution[route].usedSize <= parameters.vehicle_capacity &&
-                            requests[i].timeWindow.close > solution[route].startTime[pos - 1] +
-                                                      travelTimeMatrix[solution[route].route[pos -
-                                                                                             1].location_id][requests[i].location_id].time) {
-                        shift = calculateShift(requests[i], solution[route], pos);
-                        if (shift <= solution[route].waitTime[pos] + solution[route].maxShift[pos]) {
-                            ratio = calculateRatio(1, (travelTimeMatrix[solution[route].route[pos - 1].location_id][requests[i].location_id].cost +
-                                                          travelTimeMatrix[requests[i].location_id][solution[route].route[pos].location_id].cost -
-                                                            travelTimeMatrix[solution[route].route[pos-1].location_id][solution[route].route[pos].location_id].cost));
-                            if (ratio > bestPair.highestRatio) {
-                                bestPair.highestRatio = ratio;
-                                bestPair.indexOfRequest = i;
-                                bestPair.routeId = route;
-                                bestPair.position = pos;
-                                bestPair.shift = shift;
-                            }
-                        }
+    }
 
-                    }
-                }
+    while(!checkAllRequest(solver)){
+        //Highest regret, ties to the cheapest best insertion
+        request = -1;
+        highestRegret = 0;
+        for(int i = 0; i < requests.size(); i++){
+            const int * top = &cache.topRoutes[i * k];
+            if(requests[i].inRoute || top[0] == -1){
+                continue;
+            }
+            float best = cache.entries[i * cache.numberRoutes + top[0]].highestRatio;
+            regret = 0;
+            for(int j = 1; j < k; j++){
+                regret += top[j] == -1 ? REGRET_MISSING : best - cache.entries[i * cache.numberRoutes + top[j]].highestRatio;
             }
+            if(request == -1 || regret > highestRegret
+               || (regret == highestRegret && best > cache.entries[request * cache.numberRoutes + cache.topRoutes[request * k]].highestRatio)){
+                request = i;
+                highestRegret = regret;
+            }
+        }
+
+        if(request == -1){
+            cout << "\t- Need more vehicle\n";
+            break;
         }
+        bestPair = cache.entries[request * cache.numberRoutes + cache.topRoutes[request * k]];
 
-        if (bestPair.highestRatio != -1) {
-            //Insert request has best pair to solution
-            insertToRoute(requests[bestPair.indexOfRequest], bestPair.position, solution[bestPair.routeId],
-                          bestPair.shift, requests);
+        applyInsertion(solver, solution, bestPair);
 
-            //Update value for after insert request
-            updateAfter(solution[bestPair.routeId], bestPair.position);
+        //Only candidates into the changed route are stale
+        cache.emptyRoute[bestPair.routeId] = false;
+        evaluateRouteInsertions(solver, cache, bestPair.routeId, solution);
+        refreshRegretRoutes(solver, cache, bestPair.routeId);
+    }
+}
 
-            //Update maxshift for before insert's request
-            updateBefore(solution[bestPair.routeId], bestPair.position);
-        } else {
-            hasChange = false;
+void rankRegretRoutes(InsertionCache & cache, int request){
+    int k = cache.k;
+    int * top = &cache.topRoutes[request * k];
+    const BestPair * row = &cache.entries[request * cache.numberRoutes];
+    int j;
+    bool emptyRanked = false;
+
+    //Insertion into the sorted k first, routes without feasible position never ranked
+    fill(top, top + k, -1);
+    for(int route = 0; route < cache.numberRoutes; route++){
+        if(row[route].highestRatio <= cache.noRatio || (cache.emptyRoute[route] && emptyRanked)){
+            continue;
+        }
+        emptyRanked = emptyRanked || cache.emptyRoute[route];
+        for(j = k - 1; j >= 0 && (top[j] == -1 || row[top[j]].highestRatio < row[route].highestRatio); j--){
+            if(j + 1 < k){
+                top[j + 1] = top[j];
+            }
+        }
+        if(j + 1 < k){
+            top[j + 1] = route;
         }
-        //displayRoute();
     }
 }
 
-void insertionStep(vector < Technician > & solution, vector < Request > & requests, Parameters parameters){
-    bool static isInit = true;
-    if(isInit) {
-        firstInsertion(solution, requests, parameters);
-        isInit = false;
-    }else {
-        int select_insertion = rand() % 2;
-        switch(select_insertion){
-            case 0:
-                scoreInsertion(solution, requests, parameters);
-                break;
-            case 1:
-                greedyBasicInsertion(solution, requests, parameters);
-                break;
+void refreshRegretRoutes(Solver & solver, InsertionCache & cache, int route){
+    vector < Request > & requests = solver.requests;
+    int k = cache.k;
+    bool stale;
+
+    for(int i = 0; i < requests.size(); i++){
+        if(requests[i].inRoute){
+            continue;
+        }
+        //Rank again when route was ranked or now beats the k-th route
+        const int * top = &cache.topRoutes[i * k];
+        stale = top[k - 1] == -1 || cache.entries[i * cache.numberRoutes + route].highestRatio > cache.entries[i * cache.numberRoutes + top[k - 1]].highestRatio;
+        for(int j = 0; j < k && !stale; j++){
+            stale = top[j] == route;
+        }
+        if(stale){
+            rankRegretRoutes(cache, i);
         }
+    }
+}
+
+void scoreInsertion(Solver & solver, vector<Technician> & solution){
+    PROFILE_SCOPE(PROFILE_SCORE_INSERTION);
+    bestInsertion(solver, solution, SCORE_RULE);
+}
+
+void firstInsertion(Solver & solver, vector < Technician > & solution){
+    PROFILE_SCOPE(PROFILE_FIRST_INSERTION);
+    bestInsertion(solver, solution, FIRST_RULE);
+}
+
+void greedyBasicInsertion(Solver & solver, vector<Technician> & solution){
+    PROFILE_SCOPE(PROFILE_GREEDY_INSERTION);
+    bestInsertion(solver, solution, GREEDY_RULE);
+}
 
-        //scoreInsertion(solution);
-        //greedyBasicInsertion(solution);
+int insertionStep(Solver & solver, vector < Technician > & solution){
+    int select_insertion = pickWeighted(solver.rng, solver.insertion.weight.data(), solver.insertion.weight.size());
+    switch(select_insertion){
+        case 0:
+            scoreInsertion(solver, solution);
+            break;
+        case 1:
+            greedyBasicInsertion(solver, solution);
+            break;
+        case 2:
+            regretInsertion(solver, solution, 2);
+            break;
+        case 3:
+            regretInsertion(solver, solution, 3);
+            break;
     }
+
+    //scoreInsertion(solution);
+    //greedyBasicInsertion(solution);
+    return select_insertion;
 }
 
-void initTechnician(vector < Technician > & tech, vector < Request > & requests, Parameters parameters){
+void initTechnician(Solver & solver, vector < Technician > & tech){
+    const Parameters & parameters = solver.instance->parameters;
+    vector < Request > & requests = solver.requests;
     Technician depot;
-    requests[0].inRoute = true;
+    setCustomerInRoute(solver, requests[0].customer, true);
 
-    depot.route.push_back(requests[0]);
+    depot.route.push_back(0);
     depot.arrivingTime.push_back(0);
-    depot.maxShift.push_back(0);
+    depot.maxShift.push_back(parameters.time_horizon);
     depot.shift.push_back(0);
     depot.waitTime.push_back(0);
     depot.startTime.push_back(0);
     depot.usedSize = 0;
 
-    requests[requests.size() - 1].inRoute = true;
-    depot.route.push_back(requests[requests.size() - 1]);
+    setCustomerInRoute(solver, requests[requests.size() - 1].customer, true);
+    depot.route.push_back(requests.size() - 1);
     depot.arrivingTime.push_back(0);
     depot.maxShift.push_back(parameters.time_horizon);
     depot.shift.push_back(0);
@@ -709,35 +2907,47 @@ void initTechnician(vector < Technician > & tech, vector < Request > & requests,
 
 }
 
-void initSolution(vector < Technician > & solution, vector < Request > & requests, Parameters parameters){
-    initTechnician(solution, requests, parameters);
+void initSolution(Solver & solver, vector < Technician > & solution){
+    initTechnician(solver, solution);
     //cout << "Start initial Solution..." << endl;
-    insertionStep(solution, requests, parameters);
+    firstInsertion(solver, solution);
     //cout << "Finish initial Solution." << endl;
 }
 
-int objective(vector < Technician > solution) {
+int objective(const ProblemInstance & instance, const vector < Technician > & solution) {
+    PROFILE_SCOPE(PROFILE_OBJECTIVE);
+    const TravelMatrix & matrix = instance.matrix;
     int score = 0;
     for(int i = 0; i < solution.size(); i++) {
         for (int j = 0; j < solution[i].route.size() - 1; j++) {
-            score += travelTimeMatrix[solution[i].route[j].location_id][solution[i].route[j + 1].location_id].cost;
+            score += travelCost(matrix, solution[i].route[j], solution[i].route[j + 1]);
         }
     }
     return score;
 }
 
-bool checkAllRequest(vector < Request > requests){
-    for(int i = 0; i < requests.size(); i++){
-        if(!requests[i].inRoute){
-            return false;
+bool checkAllRequest(const Solver & solver){
+    return solver.unassigned.empty();
+}
+
+int unservableCustomer(const ProblemInstance & instance, const Technician & empty){
+    const vector < int > & customerFirst = instance.customerFirst;
+    for(int c = 1; c <= instance.parameters.number_customers; c++){
+        bool served = false;
+        for(int location = customerFirst[c]; location < customerFirst[c + 1] && !served; location++){
+            served = evaluateInsertion(instance, instance.requests[location], empty, 1).feasible;
+        }
+        if(!served){
+            return c;
         }
     }
-    return true;
+    return -1;
 }
 
-bool checkTimeWindow(Technician _tech){
+bool checkTimeWindow(const ProblemInstance & instance, const Technician & _tech){
+    const TravelMatrix & matrix = instance.matrix;
     for(int i = 0; i < _tech.route.size() - 1; i++){
-        if(_tech.startTime[i] + travelTimeMatrix[_tech.route[i].location_id][_tech.route[i+1].location_id].time > _tech.route[i+1].timeWindow.close){
+        if(_tech.startTime[i] + travelTime(matrix, _tech.route[i], _tech.route[i+1]) > instance.requests[_tech.route[i+1]].timeWindow.close){
             //cout << "Pos: " << i << endl << endl;
             return false;
         }
@@ -745,23 +2955,31 @@ bool checkTimeWindow(Technician _tech){
     return true;
 }
 
-void shakingStep(vector < Technician > & newSolution, vector < Request > & requests, Parameters parameters){
+int shakingStep(Solver & solver, vector < Technician > & newSolution){
+    const Parameters & parameters = solver.instance->parameters;
+    const Config & config = solver.config;
     //int number_erase =  int(parameters.number_customers * 4 / 5);
-    int number_erase =  rand() % (int(parameters.number_customers * 2 / 3) - 3) + 4;
+    int erase_max = maxOf(config.erase_min, minOf(parameters.number_customers, int(parameters.number_customers * config.erase_max_ratio)));
+    int number_erase =  minOf(randomInt(solver.rng, erase_max - config.erase_min + 1) + config.erase_min, parameters.number_customers);
 
     //int number_erase = rand() % int(parameters.number_customers * 1 /2) + int(parameters.number_customers * 1/ 3);
 
-    int selectRemoval = rand() % 3;
+    int selectRemoval = pickWeighted(solver.rng, solver.removal.weight.data(), solver.removal.weight.size());
+
+    //No customer in route, e.g. none fits a vehicle: nothing to remove
+    if(all_of(newSolution.begin(), newSolution.end(), [](const Technician & _tech){ return _tech.route.size() <= 2; })){
+        return selectRemoval;
+    }
 
     switch(selectRemoval){
         case 0:
-            randomRemoval(newSolution, number_erase, requests, parameters);
+            randomRemoval(solver, newSolution, number_erase);
             break;
         case 1:
-            worstRemoval(newSolution, number_erase, 2.5, requests, parameters);
+            worstRemoval(solver, newSolution, number_erase, config.worst_p);
             break;
         case 2:
-            shawRemoval(newSolution, number_erase, number_erase, requests, parameters);
+            shawRemoval(solver, newSolution, number_erase, config.shaw_p > 0 ? config.shaw_p : number_erase);
             break;
     }
 
@@ -772,257 +2990,928 @@ void shakingStep(vector < Technician > & newSolution, vector < Request > & reque
 
 //    cout << "Shaking Step: " << endl;
 //    displayRoute(newSolution);
+    return selectRemoval;
 }
 
-void randomRemoval(vector < Technician > & newSolution, int number_erase, vector < Request > & requests, Parameters parameters){
-
-    unsigned seed = chrono::system_clock::now().time_since_epoch().count();
-
+void randomRemoval(Solver & solver, vector < Technician > & newSolution, int number_erase){
+    PROFILE_SCOPE(PROFILE_RANDOM_REMOVAL);
+    const Parameters & parameters = solver.instance->parameters;
+    const vector < int > & customerFirst = solver.instance->customerFirst;
     vector < int > list_customer;
     for(int i = 1; i <= parameters.number_customers; i++){
         list_customer.push_back(i);
     }
 
-    shuffle (list_customer.begin(), list_customer.end(), default_random_engine(seed));
+    shuffle (list_customer.begin(), list_customer.end(), solver.rng);
 
+    vector < int > list_remove;
     for(int i = 0; i < number_erase; i++){
-        for(Technician& _tech: newSolution){
-            if(_tech.route.size() > 2){
-                for(int pos = 0; pos < _tech.route.size(); pos++){
-                    if(_tech.route[pos].customer_id == to_string(list_customer[i])){
-                        _tech.usedSize -= _tech.route[pos].demand;
-                        fixRequestInRoute(_tech.route[pos].customer_id, requests);
-                        _tech.route.erase(_tech.route.begin() + pos);
-                    }
-                }
-                //Update parameters
-                updateAfterErase(_tech, parameters);
+        //At most one location of a customer is in route
+        for(int location = customerFirst[list_customer[i]]; location < customerFirst[list_customer[i] + 1]; location++){
+            if(solver.routeOf[location] != -1){
+                list_remove.push_back(location);
+                break;
             }
-
         }
     }
+
+    removeLocations(solver, newSolution, list_remove);
 }
 
-int calculateShawScore(Request request_1, Request request_2, vector < Technician > & solution){
-    int s1 = 0, s2 = 0, status_2 = 0;
-    for(Technician _tech: solution){
-        for(int i = 1; i < _tech.route.size()-1; i++){
-            if(_tech.route[i].location_id == request_1.location_id){
-                s1 = _tech.startTime[i];
-                status_2++;
-            }
-            if(_tech.route[i].location_id == request_2.location_id){
-                s2 = _tech.startTime[i];
-                status_2++;
-            }
-            if(status_2 == 2){
-                break;
-            }
-        }
-        if(status_2 == 2){
-            break;
+void initRelatedness(Relatedness & relatedness, int number_location, const vector < Technician > & solution){
+    relatedness.startTime.assign(number_location, 0);
+    for(const Technician & _tech: solution){
+        for(int i = 1; i < int(_tech.route.size()) - 1; i++){
+            relatedness.startTime[_tech.route[i]] = _tech.startTime[i];
         }
     }
-    return int(travelTimeMatrix[request_1.location_id][request_2.location_id].distancne) + abs(s1 - s2) + abs(request_1.demand - request_2.demand);
 }
 
-void sortListLocation(int r, vector < int > list_location, vector < Technician> & solution, vector < Request > requests){
-    int temp;
-    for(int i = 0; i < list_location.size() - 1; i++){
-        for(int j = i + 1; j < list_location.size(); j++){
-            if(calculateShawScore(requests[r], requests[list_location[i]], solution) > calculateShawScore(requests[r], requests[list_location[j]], solution)){
-                temp = list_location[i];
-                list_location[i] = list_location[j];
-                list_location[j] = temp;
-            }
-        }
+int calculateShawScore(const ProblemInstance & instance, const Relatedness & relatedness, int location_1, int location_2){
+    return int(travelDistance(instance.matrix, location_1, location_2))
+           + abs(relatedness.startTime[location_1] - relatedness.startTime[location_2])
+           + abs(instance.requests[location_1].demand - instance.requests[location_2].demand);
+}
+
+int selectRelated(const ProblemInstance & instance, const Relatedness & relatedness, int r, vector < RequestAndScore > & candidates, int x){
+    for(RequestAndScore & candidate: candidates){
+        candidate.score = calculateShawScore(instance, relatedness, r, candidate._id);
     }
+    nth_element(candidates.begin(), candidates.begin() + x, candidates.end(),
+                [](const RequestAndScore & r1, const RequestAndScore & r2){ return r1.score < r2.score; });
+    return x;
 }
 
-void shawRemoval(vector < Technician > & solution, int number_erase, float p, vector < Request > & requests, Parameters parameters){
-    vector < int > list_location;
+void shawRemoval(Solver & solver, vector < Technician > & solution, int number_erase, float p){
+    PROFILE_SCOPE(PROFILE_SHAW_REMOVAL);
+    Relatedness relatedness;
+    vector < RequestAndScore > list_location;
+    RequestAndScore candidate;
     double  y;
 
-    for(Technician _tech: solution){
+    initRelatedness(relatedness, solver.requests.size(), solution);
+    for(const Technician & _tech: solution){
         for(int i = 1; i < _tech.route.size() - 1; i++){
-            list_location.push_back(stoi(_tech.route[i].location_id));
+            candidate._id = _tech.route[i];
+            candidate.score = 0;
+            list_location.push_back(candidate);
         }
     }
-    int r_index = int(rand() % list_location.size());
-    int r = list_location[r_index];
-    list_location.erase(list_location.begin() + r_index, list_location.begin() + r_index + 1);
+    if(list_location.empty()){
+        return;
+    }
+    int r_index = randomInt(solver.rng, list_location.size());
+    int r = list_location[r_index]._id;
+    list_location[r_index] = list_location.back();
+    list_location.pop_back();
 
     vector < int > list_remove;
 
     list_remove.push_back(r);
 
-    while(list_remove.size() < number_erase){
-        r = list_remove[rand() % list_remove.size()];
-        sortListLocation(r, list_location, solution, requests);
-
-        y = ((double) rand() / (RAND_MAX));
-        r_index = int(floor(pow(y, p) * list_location.size()));
-
-        list_remove.push_back(list_location[r_index]);
-        list_location.erase(list_location.begin() + r_index, list_location.begin() + r_index + 1);
-    }
-
-    float flag;
-    for(int i = 0; i < list_remove.size(); i++) {
-        flag = false;
-        for (Technician &_tech: solution) {
-            if (_tech.route.size() > 2) {
-                for (int pos = 1; pos < _tech.route.size() - 1; pos++) {
-                    if (to_string(list_remove[i]) == _tech.route[pos].location_id) {
-                        _tech.usedSize -= _tech.route[pos].demand;
-                        fixRequestInRoute(_tech.route[pos].customer_id, requests);
-                        _tech.route.erase(_tech.route.begin() + pos);
-                        flag = true;
-                        break;
-                    }
-                }
+    //Candidates are ranked again every round, so their order in list_location does not matter
+    while(list_remove.size() < number_erase && !list_location.empty()){
+        r = list_remove[randomInt(solver.rng, list_remove.size())];
 
-                //Update paramters
-                updateAfterErase(_tech, parameters);
-            }
-            if (flag) {
-                break;
-            }
-        }
+        y = randomUnit(solver.rng);
+        r_index = selectRelated(*solver.instance, relatedness, r, list_location, int(floor(pow(y, p) * list_location.size())));
+
+        list_remove.push_back(list_location[r_index]._id);
+        list_location[r_index] = list_location.back();
+        list_location.pop_back();
     }
+
+    removeLocations(solver, solution, list_remove);
 }
 
-bool compareScoreToSort(RequestAndScore r1, RequestAndScore r2){
-    return r1.score > r2.score;
+int removalGain(const TravelMatrix & matrix, int prev, int location, int next){
+    return travelCost(matrix, prev, location) + travelCost(matrix, location, next) - travelCost(matrix, prev, next);
 }
 
-void worstRemoval(vector < Technician > & solution, int number_erase, float p, vector < Request > & requests, Parameters parameters){
+void worstRemoval(Solver & solver, vector < Technician > & solution, int number_erase, float p){
+    PROFILE_SCOPE(PROFILE_WORST_REMOVAL);
+    const Parameters & parameters = solver.instance->parameters;
+    const TravelMatrix & matrix = solver.instance->matrix;
+    int number_location = solver.requests.size();
     double y;
     int x;
     int sizeOfCustomer = parameters.number_customers;
-    bool flag;
-
-    while(number_erase > 0){
-        vector < RequestAndScore > list_rs;
-
-        for(Technician _tech: solution){
-            if(_tech.route.size() > 2){
-                for(int i = 1; i < _tech.route.size() - 1; i++) {
-                    RequestAndScore rs;
-                    rs._id = _tech.route[i].location_id;
-                    rs.score = travelTimeMatrix[_tech.route[i-1].location_id][_tech.route[i].location_id].cost + travelTimeMatrix[_tech.route[i].location_id][_tech.route[i+1].location_id].cost - travelTimeMatrix[_tech.route[i-1].location_id][_tech.route[i+1].location_id].cost;
-                    list_rs.push_back(rs);
-                }
+
+    //Routes as linked lists: removing a location only changes the gain of its two neighbors
+    vector < int > prevOf(number_location, -1), nextOf(number_location, -1);
+    vector < int > gainOf(number_location, 0);
+    RemovalGainSet gains;
+    int live = 0;
+
+    for(const Technician & _tech: solution){
+        for(int i = 1; i < int(_tech.route.size()) - 1; i++) {
+            int location = _tech.route[i];
+            gainOf[location] = removalGain(matrix, _tech.route[i-1], location, _tech.route[i+1]);
+            gains.insert(make_pair(gainOf[location], location));
+            prevOf[location] = _tech.route[i-1];
+            nextOf[location] = _tech.route[i+1];
+            live++;
+        }
+    }
+
+    //O(n log n) to build, then O(log n) per location removed
+    vector < int > list_remove;
+    vector < char > removed(number_location, false);
+    while(number_erase > 0 && live > 0){
+        y = randomUnit(solver.rng);
+        x = minOf(int(floor(pow(y, p) * sizeOfCustomer)), live - 1);
+        RemovalGainSet::iterator selected = gains.find_by_order(x);
+
+        //Unlink x and refresh the gain of its neighbors
+        int location = selected->second;
+        gains.erase(selected);
+        int prev = prevOf[location];
+        int next = nextOf[location];
+        removed[location] = true;
+        list_remove.push_back(location);
+        nextOf[prev] = next;
+        prevOf[next] = prev;
+        for(int neighbor: {prev, next}){
+            if(solver.routeOf[neighbor] != -1 && !removed[neighbor]){
+                gains.erase(make_pair(gainOf[neighbor], neighbor));
+                gainOf[neighbor] = removalGain(matrix, prevOf[neighbor], neighbor, nextOf[neighbor]);
+                gains.insert(make_pair(gainOf[neighbor], neighbor));
             }
         }
 
-        //Sort descending
-        sort(list_rs.begin(), list_rs.end(), compareScoreToSort);
+        live--;
+        number_erase--;
+        sizeOfCustomer--;
+    }
 
-        y = ((double) rand() / (RAND_MAX));
-        x = int(floor(pow(y, p) * sizeOfCustomer));
+    removeLocations(solver, solution, list_remove);
+}
 
-//        cout << "X = " << x << endl;
-//        cout << "Request: " << list_rs[x]._id << endl;
+int localSearch(Solver & solver, vector < Technician > & solution){
+    PROFILE_SCOPE(PROFILE_LOCAL_SEARCH);
+    int cost = objective(*solver.instance, solution);
+    int size = solver.requests.size();
+    int location, idle;
+    bool improved = true;
+
+    for(const Technician & _tech: solution){
+        int load = 0;
+        for(int location: _tech.route){
+            load += solver.requests[location].demand;
+            solver.moveScratch.loadBefore[location] = load;
+        }
+    }
 
-        //Remove x
-        flag = false;
-        for(Technician & _tech: solution){
-            if(_tech.route.size() > 2){
-                for(int pos = 1; pos < _tech.route.size() - 1; pos++){
-                    if(list_rs[x]._id == _tech.route[pos].location_id){
-                        _tech.usedSize -= _tech.route[pos].demand;
-                        fixRequestInRoute(_tech.route[pos].customer_id, requests);
-                        _tech.route.erase(_tech.route.begin() + pos);
-                        flag = true;
-                        break;
-                    }
-                }
+    //Cheap inter-route neighborhoods first: a location is tried again after one of its moves
+    //is applied, the scan ends after a full round of locations without improvement
+    while(improved && !searchStopped(solver)){
+        improved = false;
+        location = 0;
+        idle = 0;
+        while(idle < size && !searchStopped(solver)){
+            if(solver.routeOf[location] != -1
+               && (relocateMove(solver, solution, location) || swapMove(solver, solution, location)
+                   || twoOptStarMove(solver, solution, location))){
+                PROFILE_COUNT(PROFILE_LOCAL_SEARCH_MOVES, 1);
+                idle = 0;
+            }else{
+                location = (location + 1) % size;
+                idle++;
+            }
+        }
 
-                //Update paramters
-                updateAfterErase(_tech, parameters);
+        //Intra-route moves may open new inter-route ones
+        for(int route = 0; route < solution.size(); route++){
+            while(!searchStopped(solver) && intraRouteMove(solver, solution, route)){
+                PROFILE_COUNT(PROFILE_LOCAL_SEARCH_MOVES, 1);
+                improved = true;
             }
-            if(flag){
-                break;
+        }
+    }
+    return cost - objective(*solver.instance, solution);
+}
+
+bool delayFits(const Technician & _tech, int pos, int arrival){
+    PROFILE_COUNT(PROFILE_LOCAL_SEARCH_PROBES, 1);
+    int delta = arrival - _tech.arrivingTime[pos];
+    return delta <= 0 || delta <= _tech.waitTime[pos] + _tech.maxShift[pos];
+}
+
+int timeSequence(const ProblemInstance & instance, int prev, int startPrev, const int * locations, int count, int step){
+    int start = startPrev;
+    int arrival;
+    for(int i = 0; i < count; i++){
+        arrival = start + travelTime(instance.matrix, prev, *locations);
+        if(arrival > instance.requests[*locations].timeWindow.close){
+            return -1;
+        }
+        start = maxOf(instance.requests[*locations].timeWindow.open, arrival);
+        prev = *locations;
+        locations += step;
+    }
+    return start;
+}
+
+bool retimeRoute(const ProblemInstance & instance, const Technician & _tech, const vector < int > & visits, int first, int rejoin){
+    int start = timeSequence(instance, visits[first - 1], _tech.startTime[first - 1], &visits[first], rejoin - first, 1);
+    return start != -1 && delayFits(_tech, rejoin, start + travelTime(instance.matrix, visits[rejoin - 1], visits[rejoin]));
+}
+
+void setRoute(Solver & solver, vector < Technician > & solution, int route, const vector < int > & visits){
+    Technician & _tech = solution[route];
+    touchRoute(solver, solution, route);
+    _tech.route = visits;
+    _tech.usedSize = 0;
+    for(int location: visits){
+        _tech.usedSize += solver.requests[location].demand;
+        solver.moveScratch.loadBefore[location] = _tech.usedSize;
+    }
+    _tech.waitTime.resize(visits.size());
+    _tech.shift.resize(visits.size());
+    _tech.maxShift.resize(visits.size());
+    _tech.arrivingTime.resize(visits.size());
+    _tech.startTime.resize(visits.size());
+    updateAfterErase(*solver.instance, _tech);
+    indexRoute(solver, solution, route, 1);
+}
+
+bool relocateMove(Solver & solver, vector < Technician > & solution, int location){
+    const ProblemInstance & instance = *solver.instance;
+    const TravelMatrix & matrix = instance.matrix;
+    const NeighborLists & neighbors = instance.neighbors;
+    int capacity = instance.parameters.vehicle_capacity;
+    int from = solver.routeOf[location];
+    const Technician & source = solution[from];
+    int s = solver.positionOf[location];
+    int last = source.route.size() - 1;
+    vector < pair < int, int > > & targets = solver.moveScratch.targets;
+    vector < int > & visits = solver.moveScratch.visits;
+
+    //Next to a neighbor of the location, on either side, or alone in one empty route
+    targets.clear();
+    for(int i = 0; i < neighbors.k; i++){
+        for(int neighbor: {neighbors.nearest[location * neighbors.k + i], neighbors.compatible[location * neighbors.k + i]}){
+            if(neighbor == -1 || solver.routeOf[neighbor] == -1 || solver.routeOf[neighbor] == from){
+                continue;
             }
+            targets.push_back(make_pair(solver.routeOf[neighbor], solver.positionOf[neighbor] + 1));
+            targets.push_back(make_pair(solver.routeOf[neighbor], solver.positionOf[neighbor]));
+        }
+    }
+    for(int route = 0; route < solution.size(); route++){
+        if(route != from && solution[route].route.size() == 2){
+            targets.push_back(make_pair(route, 1));
+            break;
         }
+    }
 
-        number_erase--;
-        sizeOfCustomer--;
+    int demand = 0;
+    for(int length = 1; length <= 3 && s + length <= last; length++){
+        //Segment route[s .. e] between a and b
+        int e = s + length - 1;
+        int a = source.route[s - 1];
+        int b = source.route[e + 1];
+        demand += instance.requests[source.route[e]].demand;
+        int removeDelta = travelCost(matrix, a, b) - travelCost(matrix, a, source.route[s]) - travelCost(matrix, source.route[e], b);
+        if(!delayFits(source, e + 1, source.startTime[s - 1] + travelTime(matrix, a, b))){
+            continue;
+        }
+
+        for(const pair < int, int > & target_pos: targets){
+            int to = target_pos.first;
+            int pos = target_pos.second;
+            const Technician & target = solution[to];
+            if(target.usedSize + demand > capacity){
+                continue;
+            }
+            int prev = target.route[pos - 1];
+            int next = target.route[pos];
+            if(removeDelta + travelCost(matrix, prev, source.route[s]) + travelCost(matrix, source.route[e], next) - travelCost(matrix, prev, next) >= 0){
+                continue;
+            }
+            int start = timeSequence(instance, prev, target.startTime[pos - 1], &source.route[s], length, 1);
+            if(start == -1 || !delayFits(target, pos, start + travelTime(matrix, source.route[e], next))){
+                continue;
+            }
+
+            //Apply
+            visits.assign(target.route.begin(), target.route.begin() + pos);
+            visits.insert(visits.end(), source.route.begin() + s, source.route.begin() + e + 1);
+            visits.insert(visits.end(), target.route.begin() + pos, target.route.end());
+            setRoute(solver, solution, to, visits);
+            visits.assign(solution[from].route.begin(), solution[from].route.begin() + s);
+            visits.insert(visits.end(), solution[from].route.begin() + e + 1, solution[from].route.end());
+            setRoute(solver, solution, from, visits);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool swapMove(Solver & solver, vector < Technician > & solution, int location){
+    const ProblemInstance & instance = *solver.instance;
+    const TravelMatrix & matrix = instance.matrix;
+    const NeighborLists & neighbors = instance.neighbors;
+    int capacity = instance.parameters.vehicle_capacity;
+    int first = solver.routeOf[location];
+    const Technician & one = solution[first];
+    int i = solver.positionOf[location];
+    int u = location;
+    int a = one.route[i - 1], b = one.route[i + 1];
+    int demand_u = instance.requests[u].demand;
+    vector < int > & visits = solver.moveScratch.visits;
+
+    //u takes the place of a neighbor v, which takes the place of u
+    for(int k = 0; k < neighbors.k; k++){
+        for(int v: {neighbors.nearest[u * neighbors.k + k], neighbors.compatible[u * neighbors.k + k]}){
+            if(v == -1 || solver.routeOf[v] == -1 || solver.routeOf[v] == first){
+                continue;
+            }
+            int second = solver.routeOf[v];
+            const Technician & other = solution[second];
+            int j = solver.positionOf[v];
+            int c = other.route[j - 1], d = other.route[j + 1];
+            int demand_v = instance.requests[v].demand;
+            if(one.usedSize - demand_u + demand_v > capacity || other.usedSize - demand_v + demand_u > capacity){
+                continue;
+            }
+            int delta = travelCost(matrix, a, v) + travelCost(matrix, v, b) - travelCost(matrix, a, u) - travelCost(matrix, u, b)
+                        + travelCost(matrix, c, u) + travelCost(matrix, u, d) - travelCost(matrix, c, v) - travelCost(matrix, v, d);
+            if(delta >= 0){
+                continue;
+            }
+            int start_v = timeSequence(instance, a, one.startTime[i - 1], &v, 1, 1);
+            if(start_v == -1 || !delayFits(one, i + 1, start_v + travelTime(matrix, v, b))){
+                continue;
+            }
+            int start_u = timeSequence(instance, c, other.startTime[j - 1], &u, 1, 1);
+            if(start_u == -1 || !delayFits(other, j + 1, start_u + travelTime(matrix, u, d))){
+                continue;
+            }
+
+            //Apply
+            visits = one.route;
+            visits[i] = v;
+            setRoute(solver, solution, first, visits);
+            visits = solution[second].route;
+            visits[j] = u;
+            setRoute(solver, solution, second, visits);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool twoOptStarMove(Solver & solver, vector < Technician > & solution, int location){
+    const ProblemInstance & instance = *solver.instance;
+    const TravelMatrix & matrix = instance.matrix;
+    const NeighborLists & neighbors = instance.neighbors;
+    int capacity = instance.parameters.vehicle_capacity;
+    int first = solver.routeOf[location];
+    const Technician & one = solution[first];
+    int i = solver.positionOf[location];
+    const vector < int > & loadBefore = solver.moveScratch.loadBefore;
+    int load_1 = loadBefore[location];
+    vector < int > & visits_1 = solver.moveScratch.visits;
+    vector < int > & visits_2 = solver.moveScratch.otherVisits;
+
+    //Exchange the tails after one.route[i] and other.route[j], the predecessor of a
+    //neighbor v, so that the location is followed by v
+    for(int k = 0; k < neighbors.k; k++){
+        for(int v: {neighbors.nearest[location * neighbors.k + k], neighbors.compatible[location * neighbors.k + k]}){
+            if(v == -1 || solver.routeOf[v] == -1 || solver.routeOf[v] == first){
+                continue;
+            }
+            int second = solver.routeOf[v];
+            const Technician & other = solution[second];
+            int j = solver.positionOf[v] - 1;
+            int load_2 = loadBefore[other.route[j]];
+            if(load_1 + other.usedSize - load_2 > capacity || load_2 + one.usedSize - load_1 > capacity){
+                continue;
+            }
+            int delta = travelCost(matrix, one.route[i], other.route[j + 1]) + travelCost(matrix, other.route[j], one.route[i + 1])
+                        - travelCost(matrix, one.route[i], one.route[i + 1]) - travelCost(matrix, other.route[j], other.route[j + 1]);
+            if(delta >= 0){
+                continue;
+            }
+            if(!delayFits(other, j + 1, one.startTime[i] + travelTime(matrix, one.route[i], other.route[j + 1]))
+               || !delayFits(one, i + 1, other.startTime[j] + travelTime(matrix, other.route[j], one.route[i + 1]))){
+                continue;
+            }
+
+            //Apply
+            visits_1.assign(one.route.begin(), one.route.begin() + i + 1);
+            visits_1.insert(visits_1.end(), other.route.begin() + j + 1, other.route.end());
+            visits_2.assign(other.route.begin(), other.route.begin() + j + 1);
+            visits_2.insert(visits_2.end(), one.route.begin() + i + 1, one.route.end());
+            setRoute(solver, solution, first, visits_1);
+            setRoute(solver, solution, second, visits_2);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool intraRouteMove(Solver & solver, vector < Technician > & solution, int route){
+    const ProblemInstance & instance = *solver.instance;
+    const TravelMatrix & matrix = instance.matrix;
+    vector < int > & visits = solver.moveScratch.visits;
+    vector < int > & forward = solver.moveScratch.forward;
+    vector < int > & backward = solver.moveScratch.backward;
+
+    const Technician & _tech = solution[route];
+    const vector < int > & visit = _tech.route;
+    int last = visit.size() - 1;
+    if(last < 3){
+        return false;
+    }
+
+    //Or-opt: segment [s, e] moved between pos - 1 and pos, before s or after e + 1
+    for(int s = 1; s < last; s++){
+        for(int e = s; e < minOf(s + 3, last); e++){
+            int removeDelta = travelCost(matrix, visit[s - 1], visit[e + 1]) - travelCost(matrix, visit[s - 1], visit[s]) - travelCost(matrix, visit[e], visit[e + 1]);
+            for(int pos = 1; pos <= last; pos++){
+                if(pos >= s && pos <= e + 1){
+                    continue;
+                }
+                if(removeDelta + travelCost(matrix, visit[pos - 1], visit[s]) + travelCost(matrix, visit[e], visit[pos]) - travelCost(matrix, visit[pos - 1], visit[pos]) >= 0){
+                    continue;
+                }
+                int first, rejoin;
+                if(pos < s){
+                    visits.assign(visit.begin(), visit.begin() + pos);
+                    visits.insert(visits.end(), visit.begin() + s, visit.begin() + e + 1);
+                    visits.insert(visits.end(), visit.begin() + pos, visit.begin() + s);
+                    visits.insert(visits.end(), visit.begin() + e + 1, visit.end());
+                    first = pos;
+                    rejoin = e + 1;
+                }else{
+                    visits.assign(visit.begin(), visit.begin() + s);
+                    visits.insert(visits.end(), visit.begin() + e + 1, visit.begin() + pos);
+                    visits.insert(visits.end(), visit.begin() + s, visit.begin() + e + 1);
+                    visits.insert(visits.end(), visit.begin() + pos, visit.end());
+                    first = s;
+                    rejoin = pos;
+                }
+                if(retimeRoute(instance, _tech, visits, first, rejoin)){
+                    setRoute(solver, solution, route, visits);
+                    return true;
+                }
+            }
+        }
+    }
+
+    //2-opt: reverse route[i + 1 .. j], costs of both directions summed along the route
+    forward.assign(last + 1, 0);
+    backward.assign(last + 1, 0);
+    for(int k = 1; k <= last; k++){
+        forward[k] = forward[k - 1] + travelCost(matrix, visit[k - 1], visit[k]);
+        backward[k] = backward[k - 1] + travelCost(matrix, visit[k], visit[k - 1]);
+    }
+    for(int i = 0; i < last - 2; i++){
+        for(int j = i + 2; j < last; j++){
+            int delta = travelCost(matrix, visit[i], visit[j]) + travelCost(matrix, visit[i + 1], visit[j + 1])
+                        - travelCost(matrix, visit[i], visit[i + 1]) - travelCost(matrix, visit[j], visit[j + 1])
+                        + (backward[j] - backward[i + 1]) - (forward[j] - forward[i + 1]);
+            if(delta >= 0){
+                continue;
+            }
+            visits = visit;
+            reverse(visits.begin() + i + 1, visits.begin() + j + 1);
+            if(retimeRoute(instance, _tech, visits, i + 1, j + 1)){
+                setRoute(solver, solution, route, visits);
+                return true;
+            }
+        }
     }
+    return false;
 }
 
-void updateAfterErase(Technician & _tech, Parameters parameters){
+void updateAfterErase(const ProblemInstance & instance, Technician & _tech){
+    PROFILE_SCOPE(PROFILE_UPDATE_AFTER_ERASE);
+    const Parameters & parameters = instance.parameters;
+    const TravelMatrix & matrix = instance.matrix;
     for(int i = 1; i < _tech.route.size(); i++){
-        _tech.arrivingTime[i] = calculateArrivingTime(_tech.route[i],  _tech, i);
-        _tech.startTime[i] = calculateStartTime(_tech.route[i], _tech, i);
-        _tech.waitTime[i] = calculateWaitTime(_tech.route[i], _tech, i);
+        _tech.arrivingTime[i] = calculateArrivingTime(matrix, instance.requests[_tech.route[i]],  _tech, i);
+        _tech.startTime[i] = calculateStartTime(matrix, instance.requests[_tech.route[i]], _tech, i);
+        _tech.waitTime[i] = calculateWaitTime(matrix, instance.requests[_tech.route[i]], _tech, i);
     }
 
     _tech.maxShift[_tech.route.size() - 1] = parameters.time_horizon - _tech.startTime[_tech.route.size() - 1];
     //_tech.maxShift[_tech.route.size() - 1] = parameters.time_horizon;
 
     for(int i = _tech.route.size() - 2; i >= 0; i--){
-        _tech.maxShift[i] = calculateMaxShift(_tech.route[i], _tech, i);
+        _tech.maxShift[i] = calculateMaxShift(instance.requests[_tech.route[i]], _tech, i);
     }
 }
 
-void fixRequestInRoute(string customer_id, vector < Request > & requests){
-    for(int i = 0; i < requests.size(); i++){
-        if(requests[i].customer_id == customer_id){
-            requests[i].inRoute = false;
+void fixRequestInRoute(Solver & solver, int customer){
+    setCustomerInRoute(solver, customer, false);
+}
+
+int heuristic(Solver & solver, vector < Technician > & solution){
+    startSearch(solver);
+    return iterateHeuristic(solver, solution, solver.config.number_iteration > 0 ? solver.config.number_iteration : INT_MAX);
+}
+
+void startSearch(Solver & solver){
+    solver.noImprovement = 0;
+    initOperators(solver);
+    solver.deadline = chrono::steady_clock::now() + chrono::duration_cast < chrono::steady_clock::duration > (chrono::duration < double > (solver.config.time_limit));
+}
+
+bool searchStopped(const Solver & solver){
+    //A clock read is far cheaper than an iteration, so the deadline is checked every time
+    return (solver.config.no_improvement_limit > 0 && solver.noImprovement >= solver.config.no_improvement_limit)
+           || (solver.config.time_limit > 0 && chrono::steady_clock::now() >= solver.deadline);
+}
+
+int iterateHeuristic(Solver & solver, vector < Technician > & solution, int number_iteration){
+    int cost = objective(*solver.instance, solution);
+    int newCost, repairedCost;
+    int i;
+    int removal, insertion;
+    int unassigned;
+    chrono::steady_clock::time_point begin, shaken, repaired;
+
+    //solution is changed in place, a rejected iteration is undone from the journal
+    for(i = 0; i < number_iteration && !searchStopped(solver); i++){
+        beginJournal(solver, solution);
+        begin = chrono::steady_clock::now();
+        unassigned = solver.unassigned.size();
+        removal = shakingStep(solver, solution);
+        unassigned = solver.unassigned.size() - unassigned;
+        shaken = chrono::steady_clock::now();
+        insertion = insertionStep(solver, solution);
+        repaired = chrono::steady_clock::now();
+        newCost = repairedCost = objective(*solver.instance, solution);
+        if(solver.config.local_search){
+            localSearch(solver, solution);
+            newCost = objective(*solver.instance, solution);
+        }
+
+        //Both operators of the iteration share its improvement, measured before local search like their time
+        recordOperator(solver.removal, removal, maxOf(0, cost - repairedCost), chrono::duration < double, milli > (shaken - begin).count());
+        recordOperator(solver.insertion, insertion, maxOf(0, cost - repairedCost), chrono::duration < double, milli > (repaired - shaken).count());
+        if(solver.config.adaptive && ++solver.segmentIterations >= solver.config.adaptive_segment){
+            adaptWeights(solver.removal, solver.config.adaptive_reaction);
+            adaptWeights(solver.insertion, solver.config.adaptive_reaction);
+            solver.segmentIterations = 0;
+        }
+
+        PROFILE_COUNT(PROFILE_ITERATIONS, 1);
+        if(newCost < cost){
+            cost = newCost;
+            solver.noImprovement = 0;
+            commitJournal(solver);
+            PROFILE_COUNT(PROFILE_ACCEPTED, 1);
+        }else{
+            solver.noImprovement++;
+            rollbackJournal(solver, solution);
+            PROFILE_COUNT(PROFILE_REJECTED, 1);
+        }
+        if(solver.trace != NULL){
+            traceIteration(solver, newCost, cost, removal, insertion, unassigned);
+        }
+    }
+    if(solver.trace != NULL){
+        flushTrace(solver);
+    }
+    return i;
+}
+
+void runTrajectory(SharedBest & shared, const Solver & master, vector < Technician > solution, ParallelOptions options, unsigned seed, int trajectory){
+    const ProblemInstance & instance = *master.instance;
+    Solver solver;
+    initSolver(solver, instance, seed);
+    loadSolution(solver, solution, master.requests);
+    solver.config = master.config;
+    solver.deadline = master.deadline;
+    solver.trace = master.trace;
+    solver.traceRun = trajectory;
+    initOperators(solver);
+
+    int number_iteration = solver.config.number_iteration > 0 ? solver.config.number_iteration : INT_MAX;
+    int cost, iterations;
+    bool stopped = false;
+    for(int done = 0; done < number_iteration && !stopped; done += iterations){
+        iterations = iterateHeuristic(solver, solution, minOf(options.exchange_interval, number_iteration - done));
+        stopped = searchStopped(solver);
+        cost = objective(instance, solution);
+
+        lock_guard < mutex > guard(shared.lock);
+        shared.iterations += iterations;
+        if(cost < shared.cost){
+            //Publish new best
+            shared.cost = cost;
+            shared.solution = solution;
+            shared.requests = solver.requests;
+        }else if(options.restart_lagging && cost > (1 + options.restart_gap) * shared.cost){
+            //Restart from the incumbent
+            solution = shared.solution;
+            loadSolution(solver, solution, shared.requests);
+            solver.noImprovement = 0;
+        }
+    }
+
+    lock_guard < mutex > guard(shared.lock);
+    mergeOperatorStats(shared.removal, solver.removal);
+    mergeOperatorStats(shared.insertion, solver.insertion);
+    shared.number_merged++;
+}
+
+int parallelHeuristic(Solver & solver, vector < Technician > & solution, ParallelOptions options, unsigned seed){
+    SharedBest shared;
+    shared.solution = solution;
+    shared.requests = solver.requests;
+    shared.cost = objective(*solver.instance, solution);
+    shared.iterations = 0;
+    shared.number_merged = 0;
+
+    startSearch(solver);
+    vector < thread > workers;
+    for(int t = 0; t < options.number_thread; t++){
+        workers.push_back(thread(runTrajectory, ref(shared), cref(solver), solution, options, seed + 7919 * (t + 1), t + 1));
+    }
+    for(thread & worker: workers){
+        worker.join();
+    }
+
+    solution = shared.solution;
+    loadSolution(solver, solution, shared.requests);
+
+    //Report the mean weights of the trajectories
+    for(float & weight: shared.removal.weight){
+        weight /= shared.number_merged;
+    }
+    for(float & weight: shared.insertion.weight){
+        weight /= shared.number_merged;
+    }
+    solver.removal = shared.removal;
+    solver.insertion = shared.insertion;
+    return shared.iterations;
+}
+
+vector < string > listInstances(string pattern){
+    vector < string > paths;
+    if(filesystem::is_directory(pattern)){
+        for(const filesystem::directory_entry & entry: filesystem::directory_iterator(pattern)){
+            if(entry.is_regular_file() && entry.path().extension() == ".txt"){
+                paths.push_back(entry.path().string());
+            }
+        }
+    }else{
+        glob_t matches;
+        if(glob(pattern.c_str(), 0, NULL, &matches) == 0){
+            for(size_t i = 0; i < matches.gl_pathc; i++){
+                paths.push_back(matches.gl_pathv[i]);
+            }
+        }
+        globfree(&matches);
+    }
+    sort(paths.begin(), paths.end());
+    return paths;
+}
+
+InstanceResult solveInstance(string path, const Config & config, unsigned seed, TraceWriter * trace, int run){
+    const chrono::steady_clock::time_point begin_time = chrono::steady_clock::now();
+
+    InstanceResult result;
+    result.path = path;
+    result.cost = 0;
+    result.unassigned = 0;
+    result.iterations = 0;
+
+    ProblemInstance instance;
+    result.loaded = readData(path, instance);
+    if(!result.loaded){
+        result.error = "cannot read instance";
+    }else{
+        Solver solver;
+        vector < Technician > solution(0);
+        initSolver(solver, instance, seed);
+        solver.config = config;
+        solver.trace = trace;
+        solver.traceRun = run;
+        initTechnician(solver, solution);
+
+        //A customer no vehicle can serve fails the record instead of being solved around
+        int customer = solution.empty() ? 1 : unservableCustomer(instance, solution[0]);
+        if(customer != -1){
+            result.error = "customer " + instance.requests[instance.customerFirst[customer]].customer_id + " fits no vehicle";
+            result.unassigned = instance.parameters.number_customers;
+        }else{
+            firstInsertion(solver, solution);
+            result.iterations = heuristic(solver, solution);
+            result.cost = objective(instance, solution);
+            result.unassigned = solver.unassigned.size();
+            result.removal = solver.removal;
+            result.insertion = solver.insertion;
+
+            for(int i = 0; i < solution.size(); i++){
+                if(solution[i].route.size() <= 2){
+                    continue;
+                }
+                vector < string > route;
+                for(int j = 0; j < solution[i].route.size(); j++){
+                    route.push_back(instance.requests[solution[i].route[j]].location_id);
+                }
+                result.routes.push_back(route);
+            }
+        }
+    }
+
+    result.wall_time = chrono::duration < double > (chrono::steady_clock::now() - begin_time).count();
+    return result;
+}
+
+void runBatch(const vector < string > & paths, int number_worker, const Config & config, unsigned seed, ostream & output, TraceWriter * trace){
+    atomic < int > next(0);
+    mutex output_lock;
+
+    auto worker = [&](){
+        for(int i = next++; i < int(paths.size()); i = next++){
+            InstanceResult result = solveInstance(paths[i], config, seed + i, trace, i);
+
+            lock_guard < mutex > guard(output_lock);
+            writeResult(output, result);
+            if(!result.error.empty()){
+                cout << "\t" << paths[i] << ": " << result.error << endl;
+            }else{
+                cout << "\t" << paths[i] << ": cost " << result.cost << ", " << result.unassigned << " unassigned in " << result.wall_time << "s" << endl;
+            }
+        }
+    };
+
+    vector < thread > workers;
+    for(int t = 0; t < minOf(number_worker, paths.size()); t++){
+        workers.push_back(thread(worker));
+    }
+    for(thread & _worker: workers){
+        _worker.join();
+    }
+}
+
+bool openTrace(TraceWriter & trace, string path){
+    trace.file.open(path, ios::out | ios::trunc);
+    if(!trace.file){
+        cerr << "Cannot write trace " << path << endl;
+        return false;
+    }
+    trace.file << "run,iteration,seconds,cost,best,removal,insertion,removed\n";
+    trace.start = chrono::steady_clock::now();
+    return true;
+}
+
+void traceIteration(Solver & solver, int cost, int best, int removal, int insertion, int removed){
+    string & line = solver.traceBuffer;
+    char seconds[32];
+    to_chars_result written = to_chars(seconds, seconds + sizeof(seconds),
+                                       chrono::duration < double > (chrono::steady_clock::now() - solver.trace->start).count(), chars_format::fixed, 6);
+
+    appendInt(line, solver.traceRun);
+    line += ',';
+    appendInt(line, ++solver.traceIteration);
+    line += ',';
+    line.append(seconds, written.ptr);
+    line += ',';
+    appendInt(line, cost);
+    line += ',';
+    appendInt(line, best);
+    line += ',';
+    line += solver.removal.name[removal];
+    line += ',';
+    line += solver.insertion.name[insertion];
+    line += ',';
+    appendInt(line, removed);
+    line += '\n';
+    if(line.size() >= TRACE_BUFFER_SIZE){
+        flushTrace(solver);
+    }
+}
+
+void flushTrace(Solver & solver){
+    lock_guard < mutex > guard(solver.trace->lock);
+    solver.trace->file.write(solver.traceBuffer.data(), solver.traceBuffer.size());
+    solver.traceBuffer.clear();
+}
+
+string jsonString(const string & value){
+    string escaped = "\"";
+    for(char c: value){
+        if(c == '"' || c == '\\'){
+            escaped += '\\';
+        }
+        escaped += c;
+    }
+    return escaped + "\"";
+}
+
+void writeResult(ostream & output, const InstanceResult & result){
+    output << "{\"instance\": " << jsonString(result.path)
+           << ", \"loaded\": " << (result.loaded ? "true" : "false")
+           << ", \"error\": " << (result.error.empty() ? "null" : jsonString(result.error))
+           << ", \"complete\": " << (result.error.empty() && result.unassigned == 0 ? "true" : "false")
+           << ", \"cost\": " << result.cost
+           << ", \"unassigned\": " << result.unassigned
+           << ", \"iterations\": " << result.iterations
+           << ", \"wall_time\": " << result.wall_time
+           << ", \"routes\": [";
+    for(int i = 0; i < result.routes.size(); i++){
+        output << (i > 0 ? ", [" : "[");
+        for(int j = 0; j < result.routes[i].size(); j++){
+            output << (j > 0 ? ", " : "") << jsonString(result.routes[i][j]);
         }
+        output << "]";
+    }
+    output << "], \"removal\": ";
+    writeOperators(output, result.removal);
+    output << ", \"insertion\": ";
+    writeOperators(output, result.insertion);
+    output << "}" << endl;
+}
+
+void writeOperators(ostream & output, const OperatorStats & stats){
+    output << "{";
+    for(int i = 0; i < stats.name.size(); i++){
+        output << (i > 0 ? ", " : "") << jsonString(stats.name[i]) << ": {\"weight\": " << stats.weight[i]
+               << ", \"calls\": " << stats.calls[i] << ", \"improvements\": " << stats.improvements[i]
+               << ", \"gain\": " << stats.gain[i] << ", \"ms\": " << stats.time[i] << "}";
+    }
+    output << "}";
+}
+
+#ifdef VRP_PROFILE
+const char * PROFILE_TIMER_NAMES[PROFILE_TIMER_COUNT] = {
+    "read_data", "random_removal", "worst_removal", "shaw_removal", "first_insertion", "score_insertion",
+    "greedy_insertion", "regret2_insertion", "regret3_insertion", "local_search", "update_after",
+    "update_before", "update_after_erase", "objective"
+};
+
+const char * PROFILE_COUNTER_NAMES[PROFILE_COUNTER_COUNT] = {
+    "iterations", "accepted", "rejected", "insertion_probes", "local_search_probes", "local_search_moves"
+};
+
+mutex profileLock;
+ProfileData profileTotal;
+
+ProfileData::ProfileData(){
+    memset(calls, 0, sizeof(calls));
+    memset(nanoseconds, 0, sizeof(nanoseconds));
+    memset(counters, 0, sizeof(counters));
+}
+
+ProfileData::~ProfileData(){
+    if(this == &profileTotal){
+        return;
+    }
+    lock_guard < mutex > guard(profileLock);
+    for(int i = 0; i < PROFILE_TIMER_COUNT; i++){
+        profileTotal.calls[i] += calls[i];
+        profileTotal.nanoseconds[i] += nanoseconds[i];
+    }
+    for(int i = 0; i < PROFILE_COUNTER_COUNT; i++){
+        profileTotal.counters[i] += counters[i];
+    }
+}
+
+ProfileScope::ProfileScope(ProfileTimer timer): timer(timer), start(chrono::steady_clock::now()){
+}
+
+ProfileScope::~ProfileScope(){
+    profileData.calls[timer]++;
+    profileData.nanoseconds[timer] += chrono::duration_cast < chrono::nanoseconds > (chrono::steady_clock::now() - start).count();
+}
+
+void writeProfile(ostream & output){
+    //Ended threads are in profileTotal, the calling thread is still in its profileData
+    lock_guard < mutex > guard(profileLock);
+    output << "{\"timers\": {";
+    for(int i = 0; i < PROFILE_TIMER_COUNT; i++){
+        int64_t calls = profileTotal.calls[i] + profileData.calls[i];
+        double milliseconds = (profileTotal.nanoseconds[i] + profileData.nanoseconds[i]) / 1e6;
+        output << (i > 0 ? ", " : "") << jsonString(PROFILE_TIMER_NAMES[i]) << ": {\"calls\": " << calls
+               << ", \"total_ms\": " << milliseconds << ", \"mean_us\": " << (calls > 0 ? 1000 * milliseconds / calls : 0) << "}";
+    }
+    output << "}, \"counters\": {";
+    for(int i = 0; i < PROFILE_COUNTER_COUNT; i++){
+        output << (i > 0 ? ", " : "") << jsonString(PROFILE_COUNTER_NAMES[i]) << ": " << profileTotal.counters[i] + profileData.counters[i];
+    }
+    output << "}}" << endl;
+}
+
+void dumpProfile(string path){
+    ofstream output(path);
+    writeProfile(output);
+    if(output){
+        cout << "Profile in " << path << endl;
+    }else{
+        cerr << "Cannot write profile " << path << endl;
     }
 }
+#endif
 
-void heuristic(vector < Technician > & solution, vector < Request > & requests, Parameters parameters){
-    vector < Technician > newSolution;
-	
-    newSolution = solution;
-
-    int numberOfTimeNoImprovement = 0;
-
-//    while(numberOfTimeNoImprovement < 4000){
-//        shakingStep(newSolution, requests, parameters);
-//        insertionStep(newSolution, requests, parameters);
-//        //cout << "object: " << objective(newSolution) << endl;
-//        if (objective(newSolution) < objective(solution)) {
-//            solution = newSolution;
-//            numberOfTimeNoImprovement = 0;
-//        }else{
-//            numberOfTimeNoImprovement++;
-//        }
-//    }
-
-      for(int i = 0; i < 5000; i++){
-          newSolution = solution;
-          shakingStep(newSolution, requests, parameters);
-          insertionStep(newSolution, requests, parameters);
-          if(objective(newSolution) < objective(solution)){
-              solution = newSolution;
-
-          }{
-              //newSolution.clear();
-              newSolution = solution;
-          }
-      }
-
-//    while(numberOfTimeNoImprovement < 7500){
-//        newSolution = solution;
-//
-//        shakingStep(newSolution, requests, parameters);
-//        insertionStep(newSolution, requests, parameters);
-//
-//        if(objective(newSolution) < objective(solution)){
-//            solution = newSolution;
-//            numberOfTimeNoImprovement = 0;
-//        }else{
-//            numberOfTimeNoImprovement++;
-//        }
-//    }
-}
-
-void displayRoute(vector < Technician > solution){
+void displayRoute(const ProblemInstance & instance, const vector < Technician > & solution){
     cout << "\tRoute for problem: " << endl;
     for(int i = 0; i < solution.size(); i++) {
         if(solution[i].route.size() <= 2){
@@ -1031,19 +3920,19 @@ void displayRoute(vector < Technician > solution){
         cout << "\t\tRoute " << i + 1 << ": ";
         for (int j = 0; j < solution[i].route.size(); j++) {
             //cout << "\t" << solution[i].route[j].customer_id << "\t";
-            cout << "\t\t" << solution[i].route[j].customer_id;
-            cout << "(id" << solution[i].route[j].location_id << ")" << "\t";
+            cout << "\t\t" << instance.requests[solution[i].route[j]].customer_id;
+            cout << "(id" << instance.requests[solution[i].route[j]].location_id << ")" << "\t";
 //                 << ", s" << solution[i].startTime[j]
 //                 << ", m" << solution[i].maxShift[j]
 //                 << ", w" << solution[i].waitTime[j]
 //                 << ")" << "\t";
         }
         //cout << " used: " << solution[i].usedSize;
-        if(!checkTimeWindow(solution[i])){
+        if(!checkTimeWindow(instance, solution[i])){
             cout << "\tInval time window!";
         }
         cout << endl;
     }
-    cout << "\twith cost: " << objective(solution) << endl;
+    cout << "\twith cost: " << objective(instance, solution) << endl;
 
 }
@@ -0,0 +1,319 @@
+/*
+ * Micro benchmarks of the solver kernels, on the shipped instance and on synthetic
+ * instances of growing size (generateInstance). Every run uses fixed seeds, so two
+ * builds are compared on the same work:
+ *     vrp_benchmark --benchmark_filter=Insertion
+ */
+#define VRP_NO_MAIN
+#include "../VRP.cpp"
+#include <benchmark/benchmark.h>
+
+static const unsigned BENCHMARK_SEED = 12345;
+
+//Instances are built once and shared by every benchmark
+static const ProblemInstance & shippedInstance(){
+    static ProblemInstance instance;
+    static bool loaded = readData(string(VRP_SOURCE_DIR) + "/instance/instance_0-triangle.txt", instance);
+    if(!loaded){
+        cerr << "Cannot read the shipped instance" << endl;
+        exit(1);
+    }
+    return instance;
+}
+
+//state.range(0) customers, 0 is the shipped instance
+static const ProblemInstance & benchmarkInstance(int number_customers){
+    static map < int, ProblemInstance > instances;
+    if(number_customers == 0){
+        return shippedInstance();
+    }
+    map < int, ProblemInstance >::iterator found = instances.find(number_customers);
+    if(found == instances.end()){
+        GeneratorOptions options = defaultGeneratorOptions();
+        options.number_customers = number_customers;
+        found = instances.emplace(number_customers, ProblemInstance()).first;
+        generateInstance(found->second, options, BENCHMARK_SEED);
+    }
+    return found->second;
+}
+
+//Initial solution of firstInsertion, the starting point of the search
+static void initialSolution(const ProblemInstance & instance, Solver & solver, vector < Technician > & solution){
+    initSolver(solver, instance, BENCHMARK_SEED);
+    solution.clear();
+    initSolution(solver, solution);
+}
+
+static void sizeArguments(benchmark::internal::Benchmark * b){
+    b->Arg(0)->Arg(25)->Arg(100)->Arg(400);
+}
+
+static void BM_ReadTextData(benchmark::State & state){
+    string path = string(VRP_SOURCE_DIR) + "/instance/instance_0-triangle.txt";
+    for(auto _ : state){
+        ProblemInstance instance;
+        benchmark::DoNotOptimize(readTextData(path, instance));
+    }
+}
+BENCHMARK(BM_ReadTextData)->Unit(benchmark::kMicrosecond);
+
+//Text file of state.range(0) customers, 0 is the shipped instance: generated ones are written to the temp directory once per run
+static string instancePath(int number_customers){
+    static map < int, string > written;
+    if(number_customers == 0){
+        return string(VRP_SOURCE_DIR) + "/instance/instance_0-triangle.txt";
+    }
+    if(written.count(number_customers)){
+        return written[number_customers];
+    }
+    string path = (filesystem::temp_directory_path() / ("vrp_benchmark_" + to_string(number_customers) + ".txt")).string();
+    written[number_customers] = path;
+    if(!writeInstance(path, benchmarkInstance(number_customers))){
+        cerr << "Cannot write " << path << endl;
+        exit(1);
+    }
+    return path;
+}
+
+//Binary cache hit, including prepareInstance: the sum of the benchmarks below
+static void BM_ReadData(benchmark::State & state){
+    string path = instancePath(state.range(0));
+    ProblemInstance warm;
+    readData(path, warm);
+    for(auto _ : state){
+        ProblemInstance instance;
+        benchmark::DoNotOptimize(readData(path, instance));
+    }
+}
+BENCHMARK(BM_ReadData)->Arg(0)->Arg(100)->Arg(400)->Unit(benchmark::kMillisecond);
+
+//Binary cache only: requests, matrices and neighbor lists
+static void BM_LoadBinaryInstance(benchmark::State & state){
+    string path = instancePath(state.range(0));
+    ProblemInstance warm;
+    readData(path, warm);
+    struct stat source;
+    stat(path.c_str(), &source);
+    for(auto _ : state){
+        ProblemInstance instance;
+        benchmark::DoNotOptimize(loadBinaryInstance(path + ".bin", source, instance));
+    }
+}
+BENCHMARK(BM_LoadBinaryInstance)->Arg(0)->Arg(100)->Arg(400)->Unit(benchmark::kMillisecond);
+
+//Derived data of prepareInstance, each step on its own
+static void BM_BuildNeighborLists(benchmark::State & state){
+    ProblemInstance instance = benchmarkInstance(state.range(0));
+    for(auto _ : state){
+        buildNeighborLists(instance, NEIGHBOR_COUNT);
+    }
+}
+BENCHMARK(BM_BuildNeighborLists)->Arg(0)->Arg(100)->Arg(400)->Unit(benchmark::kMillisecond);
+
+static void BM_BuildNeighborMask(benchmark::State & state){
+    ProblemInstance instance = benchmarkInstance(state.range(0));
+    for(auto _ : state){
+        buildNeighborMask(instance);
+    }
+}
+BENCHMARK(BM_BuildNeighborMask)->Arg(0)->Arg(100)->Arg(400)->Unit(benchmark::kMillisecond);
+
+static void BM_BuildTransposes(benchmark::State & state){
+    ProblemInstance instance = benchmarkInstance(state.range(0));
+    for(auto _ : state){
+        buildTransposes(instance.matrix);
+    }
+}
+BENCHMARK(BM_BuildTransposes)->Arg(0)->Arg(100)->Arg(400)->Unit(benchmark::kMillisecond);
+
+static void BM_GenerateInstance(benchmark::State & state){
+    GeneratorOptions options = defaultGeneratorOptions();
+    options.number_customers = state.range(0);
+    for(auto _ : state){
+        ProblemInstance instance;
+        generateInstance(instance, options, BENCHMARK_SEED);
+    }
+    state.SetComplexityN(state.range(0));
+}
+BENCHMARK(BM_GenerateInstance)->Arg(25)->Arg(100)->Arg(400)->Unit(benchmark::kMillisecond)->Complexity(benchmark::oNSquared);
+
+//Shift of every unrouted request at every position of every route
+static void BM_CalculateShift(benchmark::State & state){
+    const ProblemInstance & instance = benchmarkInstance(state.range(0));
+    Solver solver;
+    vector < Technician > solution;
+    initialSolution(instance, solver, solution);
+    randomRemoval(solver, solution, instance.parameters.number_customers / 3);
+
+    int64_t probes = 0;
+    for(auto _ : state){
+        for(int i = 0; i < solver.requests.size(); i++){
+            if(solver.requests[i].inRoute){
+                continue;
+            }
+            for(const Technician & _tech: solution){
+                for(int pos = 1; pos < _tech.route.size(); pos++){
+                    benchmark::DoNotOptimize(calculateShift(instance.matrix, solver.requests[i], _tech, pos));
+                    probes++;
+                }
+            }
+        }
+    }
+    state.SetItemsProcessed(probes);
+}
+BENCHMARK(BM_CalculateShift)->Apply(sizeArguments)->Unit(benchmark::kMicrosecond);
+
+/*
+ * Repair of a third of the customers removed from the initial solution,
+ * the copy of the damaged solution is not timed
+ */
+template <void (*insertion)(Solver &, vector < Technician > &)>
+static void BM_Insertion(benchmark::State & state){
+    const ProblemInstance & instance = benchmarkInstance(state.range(0));
+    Solver damagedSolver, solver;
+    vector < Technician > damaged, solution;
+    initialSolution(instance, damagedSolver, damaged);
+    randomRemoval(damagedSolver, damaged, instance.parameters.number_customers / 3);
+
+    for(auto _ : state){
+        state.PauseTiming();
+        solver = damagedSolver;
+        solution = damaged;
+        state.ResumeTiming();
+        insertion(solver, solution);
+    }
+}
+
+static void regret2Insertion(Solver & solver, vector < Technician > & solution){
+    regretInsertion(solver, solution, 2);
+}
+
+static void regret3Insertion(Solver & solver, vector < Technician > & solution){
+    regretInsertion(solver, solution, 3);
+}
+
+BENCHMARK_TEMPLATE(BM_Insertion, firstInsertion)->Apply(sizeArguments)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_Insertion, scoreInsertion)->Apply(sizeArguments)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_Insertion, greedyBasicInsertion)->Apply(sizeArguments)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_Insertion, regret2Insertion)->Apply(sizeArguments)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_Insertion, regret3Insertion)->Apply(sizeArguments)->Unit(benchmark::kMicrosecond);
+
+/*
+ * Removal of a third of the customers from the initial solution,
+ * the copy of the initial solution is not timed
+ */
+static void BM_Removal(benchmark::State & state, int removal){
+    const ProblemInstance & instance = benchmarkInstance(state.range(0));
+    Solver initialSolver, solver;
+    vector < Technician > initial, solution;
+    initialSolution(instance, initialSolver, initial);
+    int number_erase = maxOf(1, instance.parameters.number_customers / 3);
+
+    for(auto _ : state){
+        state.PauseTiming();
+        solver = initialSolver;
+        solution = initial;
+        state.ResumeTiming();
+        switch(removal){
+            case 0:
+                randomRemoval(solver, solution, number_erase);
+                break;
+            case 1:
+                worstRemoval(solver, solution, number_erase, solver.config.worst_p);
+                break;
+            default:
+                shawRemoval(solver, solution, number_erase, number_erase);
+                break;
+        }
+    }
+}
+BENCHMARK_CAPTURE(BM_Removal, random, 0)->Apply(sizeArguments)->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(BM_Removal, worst, 1)->Apply(sizeArguments)->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(BM_Removal, shaw, 2)->Apply(sizeArguments)->Unit(benchmark::kMicrosecond);
+
+//Longest route of the initial solution
+static const Technician & longestRoute(const vector < Technician > & solution){
+    int longest = 0;
+    for(int i = 1; i < solution.size(); i++){
+        if(solution[i].route.size() > solution[longest].route.size()){
+            longest = i;
+        }
+    }
+    return solution[longest];
+}
+
+//Delay of one unit pushed from the first visit, includes the copy of the route
+static void BM_UpdateAfter(benchmark::State & state){
+    const ProblemInstance & instance = benchmarkInstance(state.range(0));
+    Solver solver;
+    vector < Technician > solution;
+    initialSolution(instance, solver, solution);
+    const Technician & route = longestRoute(solution);
+    Technician _tech = route;
+
+    for(auto _ : state){
+        _tech = route;
+        _tech.shift[1] = 1;
+        updateAfter(_tech, 1);
+        benchmark::ClobberMemory();
+    }
+}
+BENCHMARK(BM_UpdateAfter)->Apply(sizeArguments);
+
+static void BM_UpdateBefore(benchmark::State & state){
+    const ProblemInstance & instance = benchmarkInstance(state.range(0));
+    Solver solver;
+    vector < Technician > solution;
+    initialSolution(instance, solver, solution);
+    Technician _tech = longestRoute(solution);
+
+    for(auto _ : state){
+        updateBefore(instance, _tech, _tech.route.size() - 2);
+        benchmark::ClobberMemory();
+    }
+}
+BENCHMARK(BM_UpdateBefore)->Apply(sizeArguments);
+
+static void BM_UpdateAfterErase(benchmark::State & state){
+    const ProblemInstance & instance = benchmarkInstance(state.range(0));
+    Solver solver;
+    vector < Technician > solution;
+    initialSolution(instance, solver, solution);
+    Technician _tech = longestRoute(solution);
+
+    for(auto _ : state){
+        updateAfterErase(instance, _tech);
+        benchmark::ClobberMemory();
+    }
+}
+BENCHMARK(BM_UpdateAfterErase)->Apply(sizeArguments);
+
+static void BM_Objective(benchmark::State & state){
+    const ProblemInstance & instance = benchmarkInstance(state.range(0));
+    Solver solver;
+    vector < Technician > solution;
+    initialSolution(instance, solver, solution);
+
+    for(auto _ : state){
+        benchmark::DoNotOptimize(objective(instance, solution));
+    }
+}
+BENCHMARK(BM_Objective)->Apply(sizeArguments);
+
+//Whole search: initial solution and state.range(1) ILS iterations, cost of the result as counter
+static void BM_Heuristic(benchmark::State & state){
+    const ProblemInstance & instance = benchmarkInstance(state.range(0));
+    Solver solver;
+    vector < Technician > solution;
+
+    for(auto _ : state){
+        initialSolution(instance, solver, solution);
+        solver.config.number_iteration = state.range(1);
+        heuristic(solver, solution);
+    }
+    state.counters["cost"] = objective(instance, solution);
+}
+BENCHMARK(BM_Heuristic)->Args({0, 5000})->Args({25, 1000})->Args({100, 200})->Args({400, 20})
+    ->Unit(benchmark::kMillisecond)->Iterations(1);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,188 @@
+/*
+ * Invariants of the incremental solver state, checked after every shake, repair and
+ * local search of fixed-seed rounds on the shipped instance and on synthetic instances:
+ * - schedules (startTime, waitTime, arrivingTime, maxShift) equal a full recompute
+ * - routeOf / positionOf index exactly the visits of the routes, usedSize is their demand
+ * - inRoute flags and the unassigned set agree with the routes
+ * - a rejected round rolled back from the journal gives back the solution it started from
+ * Exits with 1 on the first failing instance, run by ctest
+ */
+#define VRP_NO_MAIN
+#include "../VRP.cpp"
+
+static const unsigned TEST_SEED = 12345;
+static const int TEST_ROUNDS = 50;
+
+//Routes whose incrementally updated schedule differs from a full recompute by updateAfterErase
+static int scheduleMismatches(const ProblemInstance & instance, const vector < Technician > & solution){
+    int mismatches = 0;
+    for(const Technician & _tech: solution){
+        Technician recomputed = _tech;
+        updateAfterErase(instance, recomputed);
+        if(recomputed.startTime != _tech.startTime || recomputed.maxShift != _tech.maxShift
+           || recomputed.waitTime != _tech.waitTime || recomputed.arrivingTime != _tech.arrivingTime){
+            mismatches++;
+        }
+    }
+    return mismatches;
+}
+
+//First broken invariant of the solver state, empty when all hold
+static string checkState(const Solver & solver, const vector < Technician > & solution){
+    const ProblemInstance & instance = *solver.instance;
+    const vector < int > & customerFirst = instance.customerFirst;
+    int number_location = solver.requests.size();
+    int number_customer = int(customerFirst.size()) - 1;
+
+    int mismatches = scheduleMismatches(instance, solution);
+    if(mismatches > 0){
+        return "schedule differs from a full recompute in " + to_string(mismatches) + " routes";
+    }
+
+    //Every visit indexed at its place, every other location not indexed
+    vector < char > visited(number_location, false);
+    for(int route = 0; route < solution.size(); route++){
+        const Technician & _tech = solution[route];
+        int load = 0;
+        for(int pos = 1; pos < int(_tech.route.size()) - 1; pos++){
+            int location = _tech.route[pos];
+            if(visited[location]){
+                return "location " + to_string(location) + " visited twice";
+            }
+            visited[location] = true;
+            load += solver.requests[location].demand;
+            if(solver.routeOf[location] != route || solver.positionOf[location] != pos){
+                return "location " + to_string(location) + " indexed at (" + to_string(solver.routeOf[location]) + ", "
+                       + to_string(solver.positionOf[location]) + "), visited at (" + to_string(route) + ", " + to_string(pos) + ")";
+            }
+        }
+        if(load != _tech.usedSize){
+            return "route " + to_string(route) + " usedSize " + to_string(_tech.usedSize) + ", demand " + to_string(load);
+        }
+    }
+    for(int location = 0; location < number_location; location++){
+        if(!visited[location] && (solver.routeOf[location] != -1 || solver.positionOf[location] != -1)){
+            return "location " + to_string(location) + " indexed but not in route";
+        }
+    }
+
+    //Customers: at most one location in route, flags of all locations follow, unassigned set agrees
+    int number_unassigned = 0;
+    for(int c = 1; c < number_customer - 1; c++){
+        int in_route = 0;
+        for(int location = customerFirst[c]; location < customerFirst[c + 1]; location++){
+            in_route += visited[location];
+        }
+        if(in_route > 1){
+            return "customer " + to_string(c) + " visited " + to_string(in_route) + " times";
+        }
+        for(int location = customerFirst[c]; location < customerFirst[c + 1]; location++){
+            if(solver.requests[location].inRoute != (in_route == 1)){
+                return "location " + to_string(location) + " inRoute flag differs from the routes";
+            }
+        }
+        bool unassigned = solver.unassignedPos[c] != -1;
+        if(unassigned != (in_route == 0) || (unassigned && solver.unassigned[solver.unassignedPos[c]] != c)){
+            return "customer " + to_string(c) + " misplaced in the unassigned set";
+        }
+        number_unassigned += in_route == 0;
+    }
+    if(number_unassigned != solver.unassigned.size()){
+        return "unassigned set holds " + to_string(solver.unassigned.size()) + " customers, " + to_string(number_unassigned) + " not in route";
+    }
+    return "";
+}
+
+static bool sameSolution(const vector < Technician > & s1, const vector < Technician > & s2){
+    if(s1.size() != s2.size()){
+        return false;
+    }
+    for(int i = 0; i < s1.size(); i++){
+        if(s1[i].route != s2[i].route || s1[i].startTime != s2[i].startTime || s1[i].waitTime != s2[i].waitTime
+           || s1[i].arrivingTime != s2[i].arrivingTime || s1[i].maxShift != s2[i].maxShift || s1[i].usedSize != s2[i].usedSize){
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * Shake, repair and local search rounds like iterateHeuristic, every other round rolled back
+ * @return false and print the broken invariant when one fails
+ */
+static bool testInstance(const string & name, const ProblemInstance & instance){
+    Solver solver;
+    vector < Technician > solution;
+    initSolver(solver, instance, TEST_SEED);
+    initSolution(solver, solution);
+
+    string error = checkState(solver, solution);
+    for(int i = 0; i < TEST_ROUNDS && error.empty(); i++){
+        vector < Technician > before = solution;
+        vector < Request > beforeRequests = solver.requests;
+        vector < int > beforeRouteOf = solver.routeOf;
+        vector < int > beforePositionOf = solver.positionOf;
+
+        beginJournal(solver, solution);
+        shakingStep(solver, solution);
+        error = checkState(solver, solution);
+        if(error.empty()){
+            insertionStep(solver, solution);
+            error = checkState(solver, solution);
+        }
+        if(error.empty()){
+            localSearch(solver, solution);
+            error = checkState(solver, solution);
+        }
+        if(!error.empty()){
+            error = "round " + to_string(i) + ": " + error;
+            break;
+        }
+
+        if(i % 2 == 0){
+            commitJournal(solver);
+            continue;
+        }
+        rollbackJournal(solver, solution);
+        error = checkState(solver, solution);
+        bool sameFlags = true;
+        for(int r = 0; r < solver.requests.size(); r++){
+            sameFlags = sameFlags && solver.requests[r].inRoute == beforeRequests[r].inRoute;
+        }
+        if(error.empty() && (!sameSolution(solution, before) || !sameFlags
+                             || solver.routeOf != beforeRouteOf || solver.positionOf != beforePositionOf)){
+            error = "rollback does not restore the solution";
+        }
+        if(!error.empty()){
+            error = "round " + to_string(i) + " rolled back: " + error;
+        }
+    }
+
+    if(!error.empty()){
+        cerr << name << ": " << error << endl;
+        return false;
+    }
+    cout << name << ": ok" << endl;
+    return true;
+}
+
+int main(){
+    bool ok = true;
+
+    ProblemInstance shipped;
+    if(!readData(string(VRP_SOURCE_DIR) + "/instance/instance_0-triangle.txt", shipped)){
+        cerr << "Cannot read the shipped instance" << endl;
+        return 1;
+    }
+    ok = testInstance("instance_0", shipped) && ok;
+
+    //The generated matrix must keep the schedule updates exact as well
+    for(int number_customers: {25, 100}){
+        GeneratorOptions options = defaultGeneratorOptions();
+        options.number_customers = number_customers;
+        ProblemInstance instance;
+        generateInstance(instance, options, TEST_SEED);
+        ok = testInstance("generated_" + to_string(number_customers), instance) && ok;
+    }
+    return ok ? 0 : 1;
+}